@@ -0,0 +1,328 @@
+/**
+  PadawanFXBench - cycle counts for the PadawanFXMega hot paths, run on the Mega itself.
+
+  Each routine is run BENCH_RUNS times on its own with fixed inputs.  The WAV Trigger is replaced
+  by a stream that counts what is written and plays back a canned response, Timer1 runs at the
+  CPU clock and counts cycles.  Results are printed as CSV, one row per routine:
+
+    BENCH,name,runs,min_cycles,mean_cycles,max_cycles,tx_bytes,stack_bytes
+
+  cycles   - per call, the cost of the measurement itself is already taken off. Timer0 (millis)
+             stays on like it is on the droid, min is the number to compare.
+  tx_bytes - per call, serial bytes to the WAV Trigger plus I2C bytes to the servo boards
+             (address byte included) worked out from the transfers the call makes.
+  stack    - deepest stack use of any call in bytes, interrupts taken during the call included.
+
+  The sketch is built from the PadawanFXMega sources, point the compiler at that folder:
+
+    arduino-cli compile -b arduino:avr:mega \
+      --build-property "compiler.cpp.extra_flags=-I$(pwd)/PadawanFXMega" PadawanFXBench
+
+  Open the serial monitor at 115200 baud and copy the BENCH lines into baseline.csv.  Wire
+  can't be stubbed, the servo rows talk to the real bus: run it with the PWM boards connected
+  to get their transfer time, without them every transfer stops at the address NACK.
+
+  Logging is silenced, the numbers don't include the cost of the log output.
+*/
+#include <Wire.h>
+#include <Adafruit_PWMServoDriver.h>
+#include <ArduinoLog.h>
+#include "Sounds.h"
+#include "PadawanFXConfig.h"
+#include "DriveMath.h"
+#include "SoundPlayer.h"
+
+#include "libs/TimedServos/TimedServos.h"
+#include "libs/TimedServos/TimedServos.cpp"
+#include "libs/WavTrigger2/WavTrigger2.h"
+#include "libs/WavTrigger2/WavTrigger2.cpp"
+#include "SoundPlayer.cpp"
+
+#define BENCH_RUNS 100
+// left unpainted above the heap in case something allocates while a routine runs
+#define BENCH_STACK_GUARD 64
+#define BENCH_STACK_PAINT 0xA5
+// servos moving in the busy servo loop
+#define BENCH_SERVO_CHANNELS 8
+// one PCA9685 setPWM() transfer, address, register and four bytes of on/off counts
+#define BENCH_PCA9685_WRITE_BYTES 6
+// a sound, not music, so playing it doesn't toggle the background music state between runs
+#define BENCH_SOUND_TRACK 5
+
+/**
+   Stands in for the WAV Trigger serial port, counts the bytes written and returns a canned
+   response.
+*/
+class BenchStream : public Stream {
+
+  private:
+    const uint8_t* rx = NULL;
+    uint8_t rxLength = 0;
+    uint8_t rxIndex = 0;
+
+  public:
+    unsigned long txBytes = 0;
+
+    void load(const uint8_t* data, uint8_t length) {
+      rx = data;
+      rxLength = length;
+      rxIndex = 0;
+    }
+
+    int available() {
+      return rxLength - rxIndex;
+    }
+
+    int read() {
+      return rxIndex < rxLength ? rx[rxIndex++] : -1;
+    }
+
+    int peek() {
+      return rxIndex < rxLength ? rx[rxIndex] : -1;
+    }
+
+    size_t write(uint8_t b) {
+      txBytes++;
+      return 1;
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) {
+      txBytes += size;
+      return size;
+    }
+
+    void flush() {}
+};
+
+// status with tracks 5 and 18 playing
+const uint8_t RSP_STATUS_PACKET[] = { HEAD_1, HEAD_2, 0x09, RSP_STATUS, 0x05, 0x00, 0x12, 0x00, EOM };
+const uint8_t RSP_VERSION_PACKET[] = {
+  HEAD_1, HEAD_2, 0x19, RSP_VERSION_STRING,
+  'W', 'A', 'V', ' ', 'T', 'r', 'i', 'g', 'g', 'e', 'r', ' ', 'v', '1', '.', '3', '4', ' ', ' ', ' ',
+  EOM
+};
+
+BenchStream wavStream;
+WavTrigger2 wTrig;
+TimedServos* ts = TimedServos::getInstance();
+SoundPlayer* player = SoundPlayer::getInstance();
+
+volatile uint16_t timer1Overflows = 0;
+uint32_t overheadCycles = 0;
+unsigned long i2cBytes = 0;
+
+volatile int16_t benchHatY = 0;
+volatile int16_t benchHatX = 0;
+volatile int16_t benchHatDome = 0;
+volatile char benchDrive = 0;
+volatile char benchTurn = 0;
+volatile char benchDome = 0;
+
+ISR(TIMER1_OVF_vect) {
+  timer1Overflows++;
+}
+
+uint32_t cycleCount() {
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t low = TCNT1;
+  uint16_t high = timer1Overflows;
+  // the counter wrapped but the overflow hasn't been serviced yet
+  if ((TIFR1 & _BV(TOV1)) && low < 0x8000) {
+    high++;
+  }
+  SREG = oldSREG;
+  return ((uint32_t) high << 16) | low;
+}
+
+void setup() {
+  Serial.begin(115200);
+  Log.begin(LOG_LEVEL_SILENT, &Serial);
+
+  // Timer1 free running at the CPU clock
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10);
+  TCNT1 = 0;
+  TIMSK1 = _BV(TOIE1);
+
+  wTrig.setup(&wavStream);
+  player->setup(&wTrig);
+
+  ts->setup();
+  for (uint8_t board = 0; board < 2; board++) {
+    for (uint8_t channel = 0; channel < 16; channel++) {
+      ts->servoBoards[board].channels[channel].srvMin = 150;
+      ts->servoBoards[board].channels[channel].srvMax = 600;
+    }
+  }
+
+  Serial.print(F("# PadawanFXBench, F_CPU "));
+  Serial.print(F_CPU);
+  Serial.print(F(", free RAM "));
+  Serial.println(freeRam());
+  Serial.println(F("BENCH,name,runs,min_cycles,mean_cycles,max_cycles,tx_bytes,stack_bytes"));
+
+  overheadCycles = runBench(F("overhead"), prepareNothing, runNothing);
+  runBench(F("drive_math"), prepareDriveMath, runDriveMath);
+  runBench(F("drive_math_centered"), prepareDriveMathCentered, runDriveMath);
+  runBench(F("servos_idle"), prepareServosIdle, runServos);
+  runBench(F("servos_moving"), prepareServosMoving, runServos);
+  runBench(F("wav_update_status"), prepareWavStatus, runWavUpdate);
+  runBench(F("wav_update_version"), prepareWavVersion, runWavUpdate);
+  runBench(F("play_sound_track"), prepareWavStatus, runPlaySound);
+  Serial.println(F("# done"));
+}
+
+void loop() {
+}
+
+extern char __heap_start, *__brkval;
+
+int freeRam() {
+  char v;
+  return (int) &v - (__brkval == 0 ? (int) &__heap_start : (int) __brkval);
+}
+
+uint8_t* stackBottom() {
+  return (uint8_t*) (__brkval == 0 ? &__heap_start : __brkval) + BENCH_STACK_GUARD;
+}
+
+/**
+ * Runs a routine BENCH_RUNS times, prepare() sets up the inputs before every run and isn't
+ * counted.  Prints the CSV row and returns the fewest cycles a call took.
+ */
+uint32_t runBench(const __FlashStringHelper* name, void (*prepare)(), void (*run)()) {
+  uint32_t minCycles = 0xFFFFFFFF;
+  uint32_t maxCycles = 0;
+  uint32_t totalCycles = 0;
+  unsigned long totalTxBytes = 0;
+  uint16_t maxStack = 0;
+
+  Serial.flush();
+  for (uint16_t i = 0; i < BENCH_RUNS; i++) {
+    i2cBytes = 0;
+    prepare();
+    wavStream.txBytes = 0;
+
+    // paint the free stack, whatever the call overwrites was used.  Painting and scanning are
+    // done in place, a function call would leave its own frame on the painted stack
+    uint8_t* bottom = stackBottom();
+    uint8_t* top = (uint8_t*) SP;
+    for (uint8_t* p = bottom; p <= top; p++) {
+      *p = BENCH_STACK_PAINT;
+    }
+
+    uint32_t start = cycleCount();
+    run();
+    uint32_t cycles = cycleCount() - start;
+
+    uint8_t* used = bottom;
+    while (used <= top && *used == BENCH_STACK_PAINT) {
+      used++;
+    }
+    uint16_t stack = top + 1 - used;
+
+    cycles = cycles > overheadCycles ? cycles - overheadCycles : 0;
+    minCycles = min(minCycles, cycles);
+    maxCycles = max(maxCycles, cycles);
+    totalCycles += cycles;
+    totalTxBytes += wavStream.txBytes + i2cBytes;
+    maxStack = max(maxStack, stack);
+  }
+
+  Serial.print(F("BENCH,"));
+  Serial.print(name);
+  Serial.print(',');
+  Serial.print(BENCH_RUNS);
+  Serial.print(',');
+  Serial.print(minCycles);
+  Serial.print(',');
+  Serial.print(totalCycles / BENCH_RUNS);
+  Serial.print(',');
+  Serial.print(maxCycles);
+  Serial.print(',');
+  Serial.print(totalTxBytes / BENCH_RUNS);
+  Serial.print(',');
+  Serial.println(maxStack);
+  return minCycles;
+}
+
+void prepareNothing() {
+}
+
+void runNothing() {
+}
+
+// full stick from a standstill, the drive ramps and every axis goes through map()
+void prepareDriveMath() {
+  benchHatY = 24000;
+  benchHatX = -12000;
+  benchHatDome = 30000;
+  benchDrive = 0;
+}
+
+// every axis inside the dead zone
+void prepareDriveMathCentered() {
+  benchHatY = 1000;
+  benchHatX = -1000;
+  benchHatDome = 500;
+  benchDrive = 0;
+}
+
+// the same math as drive(), without reading the controller or posting to the motors
+void runDriveMath() {
+  benchDrive = ramp_throttle(benchDrive, stick_to_throttle(benchHatY, RIGHT_HAT_Y_NEUTRAL, DRIVESPEED3), RAMPING);
+  benchTurn = stick_to_throttle(benchHatX, RIGHT_HAT_X_NEUTRAL, TURNSPEED);
+  benchDome = stick_to_throttle(benchHatDome, LEFT_HAT_X_NEUTRAL, DOMESPEED);
+}
+
+// every servo at rest and already disabled, the loop only checks the timers
+void prepareServosIdle() {
+  for (uint8_t board = 0; board < 2; board++) {
+    for (uint8_t channel = 0; channel < 16; channel++) {
+      ts->servoBoards[board].channels[channel].startPos = 64;
+      ts->servoBoards[board].channels[channel].endPos = 64;
+      ts->servoBoards[board].channels[channel].currPos = 64;
+      ts->servoBoards[board].channels[channel].isDisabled = true;
+    }
+  }
+}
+
+// BENCH_SERVO_CHANNELS servos on the first board just starting a move
+void prepareServosMoving() {
+  prepareServosIdle();
+  for (uint8_t channel = 0; channel < BENCH_SERVO_CHANNELS; channel++) {
+    ts->servoBoards[0].channels[channel].currPos = 0;
+    ts->setServoPosition(0, channel, 127, 1000);
+  }
+  // every servo that isn't at its target gets a new pulse length
+  for (uint8_t board = 0; board < 2; board++) {
+    for (uint8_t channel = 0; channel < 16; channel++) {
+      if (ts->servoBoards[board].channels[channel].currPos != ts->servoBoards[board].channels[channel].endPos) {
+        i2cBytes += BENCH_PCA9685_WRITE_BYTES;
+      }
+    }
+  }
+}
+
+void runServos() {
+  ts->loop();
+}
+
+void prepareWavStatus() {
+  wavStream.load(RSP_STATUS_PACKET, sizeof(RSP_STATUS_PACKET));
+}
+
+void prepareWavVersion() {
+  wavStream.load(RSP_VERSION_PACKET, sizeof(RSP_VERSION_PACKET));
+}
+
+// frames the whole canned response and parses it
+void runWavUpdate() {
+  wTrig.update();
+}
+
+// the status query is answered straight away from the canned response
+void runPlaySound() {
+  player->play(BENCH_SOUND_TRACK);
+}
@@ -0,0 +1,101 @@
+#include "BootSequence.h"
+
+static const char STAGE_NAMES[BOOT_STAGE_COUNT][7] PROGMEM = {
+  "serial", "motors", "usb", "servos", "audio"
+};
+
+BootSequence::BootSequence() {}
+
+BootSequence* BootSequence::getInstance() {
+  static BootSequence boot;
+  return &boot;
+}
+
+void BootSequence::begin(BootStage stage) {
+  stages[stage].startMillis = millis();
+  stages[stage].isStarted = true;
+}
+
+void BootSequence::done(BootStage stage, boolean ok) {
+  if (stages[stage].isDone) {
+    return;
+  }
+  stages[stage].doneMillis = millis();
+  stages[stage].isDone = true;
+  stages[stage].isOk = ok;
+
+  char name[7];
+  strcpy_P(name, STAGE_NAMES[stage]);
+  if (ok) {
+    Log.notice(F("Boot stage %s done in %l ms"CR), name, elapsed(stage));
+  } else {
+    Log.warning(F("Boot stage %s gave up after %l ms"CR), name, elapsed(stage));
+  }
+}
+
+boolean BootSequence::isStarted(BootStage stage) {
+  return stages[stage].isStarted;
+}
+
+boolean BootSequence::isDone(BootStage stage) {
+  return stages[stage].isDone;
+}
+
+unsigned long BootSequence::elapsed(BootStage stage) {
+  if (!stages[stage].isStarted) {
+    return 0;
+  }
+  return (stages[stage].isDone ? stages[stage].doneMillis : millis()) - stages[stage].startMillis;
+}
+
+boolean BootSequence::isReady() {
+  if (isBootReady) {
+    return true;
+  }
+  boolean isLate = millis() > BOOT_BUDGET_MS;
+  boolean isAllDone = true;
+  for (uint8_t stage = 0; stage < BOOT_STAGE_COUNT; stage++) {
+    if (!stages[stage].isDone) {
+      isAllDone = false;
+      if (isLate && !isOverBudget) {
+        char name[7];
+        strcpy_P(name, STAGE_NAMES[stage]);
+        Log.warning(F("Boot over its %d ms budget, stage %s still running after %l ms"CR), BOOT_BUDGET_MS, name,
+                    elapsed((BootStage) stage));
+      }
+    }
+  }
+  if (!isAllDone) {
+    isOverBudget = isOverBudget || isLate;
+    return false;
+  }
+
+  isBootReady = true;
+  readyMillis = millis();
+  if (readyMillis > BOOT_BUDGET_MS) {
+    Log.warning(F("Boot complete, ready to drive after %l ms, over the %d ms budget"CR), readyMillis, BOOT_BUDGET_MS);
+  } else {
+    Log.notice(F("Boot complete, ready to drive after %l ms"CR), readyMillis);
+  }
+  return true;
+}
+
+unsigned long BootSequence::bootMillis() {
+  return readyMillis;
+}
+
+boolean BootSequence::report(uint8_t line) {
+  if (line == 0) {
+    Log.notice(F("Boot: ready after %l ms, budget %d ms"CR), readyMillis, BOOT_BUDGET_MS);
+    return true;
+  }
+  uint8_t stage = line - 1;
+  if (stage >= BOOT_STAGE_COUNT) {
+    return false;
+  }
+  char name[7];
+  strcpy_P(name, STAGE_NAMES[stage]);
+  Log.notice(F(" -- %s: started at %l ms, took %l ms, ok %t"CR), name, stages[stage].startMillis,
+             elapsed((BootStage) stage), stages[stage].isOk);
+  return true;
+}
@@ -0,0 +1,90 @@
+#ifndef BOOT_SEQUENCE_H_
+#define BOOT_SEQUENCE_H_
+
+#if (ARDUINO >= 100)
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <ArduinoLog.h>
+
+// Wait for the USB serial port before booting, only useful when debugging the boot from a
+// freshly opened serial monitor.  The wait gives up after BOOT_SERIAL_WAIT_MS.
+#define BOOT_WAIT_FOR_SERIAL false
+#define BOOT_SERIAL_WAIT_MS 3000
+
+// Boot to drivable time that is expected, anything longer is logged as a warning so a slow
+// boot gets noticed.  The receiver enumerating over USB usually takes the longest.
+#define BOOT_BUDGET_MS 5000
+
+// how long the audio stage waits for each WAV Trigger query before carrying on without it
+#define BOOT_AUDIO_TIMEOUT_MS 2000
+
+enum BootStage : uint8_t {
+  BOOT_SERIAL = 0,
+  BOOT_MOTORS,
+  BOOT_USB,
+  BOOT_SERVOS,
+  BOOT_AUDIO,
+  BOOT_STAGE_COUNT
+};
+
+/**
+   Keeps track of the startup stages, which can overlap, and how long each one took.  The droid
+   is ready to drive once every stage is done.
+*/
+class BootSequence {
+
+    typedef struct
+    {
+      unsigned long startMillis = 0;
+      unsigned long doneMillis = 0;
+      boolean isStarted = false;
+      boolean isDone = false;
+      boolean isOk = false;
+    } StageTiming;
+
+  private:
+    StageTiming stages[BOOT_STAGE_COUNT];
+    unsigned long readyMillis = 0;
+    boolean isBootReady = false;
+    boolean isOverBudget = false;
+
+    BootSequence();
+    BootSequence(BootSequence const&); // copy disabled
+    void operator=(BootSequence const&); // assigment disabled
+
+  public:
+    static BootSequence* getInstance();
+
+    void begin(BootStage stage);
+
+    /**
+     * Marks a stage as done, ok is false if it gave up (e.g. timed out) and the droid carries on
+     * without it.
+     */
+    void done(BootStage stage, boolean ok = true);
+
+    boolean isStarted(BootStage stage);
+    boolean isDone(BootStage stage);
+    unsigned long elapsed(BootStage stage);
+
+    /**
+     * True once every stage is done, logs the boot time the first time it becomes ready.  Warns
+     * once if the droid isn't ready within BOOT_BUDGET_MS, with the stages still running.
+     */
+    boolean isReady();
+
+    /**
+     * Millis from power on until the droid was ready, 0 while still booting.
+     */
+    unsigned long bootMillis();
+
+    /**
+     * Logs one line of the boot timing, the total first and then one per stage.  Returns false
+     * once line is past the last one.
+     */
+    boolean report(uint8_t line);
+};
+#endif //BOOT_SEQUENCE_H_
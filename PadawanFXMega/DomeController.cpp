@@ -0,0 +1,252 @@
+#include <util/atomic.h>
+
+#include "DomeController.h"
+
+static volatile int32_t encoderTicks = 0;
+static volatile boolean isHomeSeen = false;
+static volatile int32_t homeTicks = 0;
+
+#if DOME_HAS_POSITION_SENSOR && !defined(DOME_SIMULATED_PLANT)
+static boolean wasOnHome = false;
+
+static void on_encoder_edge() {
+  // A and B equal on an A edge means one direction, different means the other
+  boolean isForward = (digitalRead(DOME_ENCODER_A_PIN) == digitalRead(DOME_ENCODER_B_PIN)) != DOME_ENCODER_REVERSED;
+  encoderTicks += isForward ? 1 : -1;
+  // only the edge of the sensor that is met going forward, going backward meets the other edge
+  // of the magnet and would index a few ticks off
+  boolean isOnHome = digitalRead(DOME_HOME_PIN) == LOW;
+  if (isOnHome && !wasOnHome && isForward) {
+    homeTicks = encoderTicks;
+    isHomeSeen = true;
+  }
+  wasOnHome = isOnHome;
+}
+#endif
+
+DomeController::DomeController() {}
+
+DomeController* DomeController::getInstance() {
+  static DomeController dome;
+  return &dome;
+}
+
+void DomeController::setup(MotorArbiter* arbiter) {
+  this->arbiter = arbiter;
+#if DOME_HAS_POSITION_SENSOR && !defined(DOME_SIMULATED_PLANT)
+  pinMode(DOME_ENCODER_A_PIN, INPUT_PULLUP);
+  pinMode(DOME_ENCODER_B_PIN, INPUT_PULLUP);
+  pinMode(DOME_HOME_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(DOME_ENCODER_A_PIN), on_encoder_edge, CHANGE);
+#endif
+  Log.notice(F("Dome setup, position sensor: %t"CR), DOME_HAS_POSITION_SENSOR);
+}
+
+int32_t DomeController::readTicks() {
+  int32_t ticks;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    ticks = encoderTicks;
+  }
+  return ticks;
+}
+
+void DomeController::setMode(DomeMode mode) {
+  this->mode = mode;
+  modeMillis = millis();
+}
+
+void DomeController::home() {
+  if (!DOME_HAS_POSITION_SENSOR) {
+    return;
+  }
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    isHomeSeen = false;
+  }
+  isHomed = false;
+  moveSource = MOTOR_SRC_SEQUENCE;
+  setMode(DOME_HOMING);
+  Log.notice(F("Homing dome."CR));
+}
+
+void DomeController::setManualThrottle(int8_t throttle) {
+  manualThrottle = throttle;
+  if (throttle != 0 && mode != DOME_MANUAL) {
+    if (mode == DOME_HOMING) {
+      Log.warning(F("Dome homing aborted by stick."CR));
+    }
+    setMode(DOME_MANUAL);
+  } else if (throttle == 0 && mode == DOME_MANUAL) {
+    setMode(isHomed ? DOME_IDLE : DOME_UNHOMED);
+  }
+}
+
+boolean DomeController::moveTo(int16_t degrees, MotorSource source) {
+  if (!isHomed || mode == DOME_MANUAL) {
+    return false;
+  }
+  degrees %= 360;
+  targetAngle = (degrees < 0) ? degrees + 360 : degrees;
+  int32_t ticks = ((int32_t) (targetAngle - DOME_HOME_ANGLE) * DOME_TICKS_PER_REV) / 360;
+  axis.setTarget((ticks < 0) ? ticks + DOME_TICKS_PER_REV : ticks);
+  moveSource = source;
+  lastPidMillis = millis() - DOME_PID_INTERVAL_MS;
+  setMode(DOME_POSITIONING);
+  Log.notice(F("Dome moving to: %d"CR), targetAngle);
+  return true;
+}
+
+boolean DomeController::faceForward(MotorSource source) {
+  return moveTo(0, source);
+}
+
+void DomeController::spin(int8_t speed, uint16_t duration, MotorSource source) {
+  if (mode == DOME_MANUAL || mode == DOME_HOMING) {
+    return;
+  }
+  spinThrottle = speed;
+  spinDuration = duration;
+  moveSource = source;
+  setMode(DOME_SPINNING);
+}
+
+void DomeController::stop() {
+  manualThrottle = 0;
+  output = 0;
+  if (mode == DOME_HOMING) {
+    Log.warning(F("Dome homing aborted."CR));
+  }
+  setMode(isHomed ? DOME_IDLE : DOME_UNHOMED);
+}
+
+boolean DomeController::hasPosition() {
+  return isHomed;
+}
+
+boolean DomeController::isMoving() {
+  return mode == DOME_HOMING || mode == DOME_POSITIONING || mode == DOME_SPINNING;
+}
+
+int16_t DomeController::getAngle() {
+  int16_t degrees = ((axis.position(readTicks()) * 360L) / DOME_TICKS_PER_REV + DOME_HOME_ANGLE) % 360;
+  return (degrees < 0) ? degrees + 360 : degrees;
+}
+
+int16_t DomeController::getTargetAngle() {
+  return targetAngle;
+}
+
+void DomeController::runHoming() {
+  boolean isSeen;
+  int32_t ticks;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    isSeen = isHomeSeen;
+    ticks = homeTicks;
+  }
+
+  if (isSeen) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      isHomeSeen = false;
+    }
+    axis.index(ticks);
+    isHomed = true;
+    output = 0;
+    Log.notice(F("Dome homed after %l ms."CR), millis() - modeMillis);
+    setMode(DOME_IDLE);
+    faceForward(moveSource);
+  } else if (millis() - modeMillis > DOME_HOMING_TIMEOUT_MS) {
+    output = 0;
+    Log.error(F("Dome home sensor not found, staying open loop."CR));
+    setMode(DOME_UNHOMED);
+  } else {
+    output = DOME_HOMING_SPEED;
+  }
+}
+
+void DomeController::reindex() {
+  boolean isSeen;
+  int32_t ticks;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    isSeen = isHomeSeen;
+    ticks = homeTicks;
+    isHomeSeen = false;
+  }
+
+  if (isSeen) {
+    int32_t drift = axis.index(ticks);
+    if (drift != 0) {
+      Log.notice(F("Dome re-indexed, encoder drifted %l ticks."CR), drift);
+    }
+  }
+}
+
+void DomeController::runPid() {
+  // keeps holding the target until the dome has come to rest on it
+  output = axis.update(readTicks());
+  if (axis.hasArrived()) {
+    output = 0;
+    setMode(DOME_IDLE);
+  }
+}
+
+void DomeController::loop() {
+  unsigned long now = millis();
+
+  if (now - lastPidMillis >= DOME_PID_INTERVAL_MS) {
+#ifdef DOME_SIMULATED_PLANT
+    if (plant.step(arbiter->getOutput(MOTOR_DOME), DOME_PID_INTERVAL_MS) && plant.speed() > 0) {
+      homeTicks = plant.position();
+      isHomeSeen = true;
+    }
+    encoderTicks = plant.position();
+#endif
+    lastPidMillis = now;
+    if (mode == DOME_HOMING) {
+      runHoming();
+    } else if (isHomed) {
+      reindex();
+    }
+    if (mode == DOME_POSITIONING) {
+      runPid();
+    }
+  }
+
+  switch (mode) {
+    case DOME_MANUAL:
+      output = manualThrottle;
+      break;
+    case DOME_SPINNING:
+      output = spinThrottle;
+      if (now - modeMillis >= spinDuration) {
+        output = 0;
+        setMode(isHomed ? DOME_IDLE : DOME_UNHOMED);
+      }
+      break;
+    case DOME_IDLE:
+    case DOME_UNHOMED:
+      output = 0;
+      break;
+    default:
+      break;
+  }
+
+  postOutput();
+}
+
+void DomeController::postOutput() {
+  if (mode != DOME_MANUAL && !isMoving()) {
+    // nothing to do, let the arbiter stop the dome
+    if (isPosted) {
+      arbiter->release(MOTOR_DOME, postedSource);
+      isPosted = false;
+    }
+    return;
+  }
+
+  MotorSource source = (mode == DOME_MANUAL) ? MOTOR_SRC_STICK : moveSource;
+  if (isPosted && source != postedSource) {
+    arbiter->release(MOTOR_DOME, postedSource);
+  }
+  arbiter->post(MOTOR_DOME, source, output, DOME_REQUEST_TTL_MS);
+  postedSource = source;
+  isPosted = true;
+}
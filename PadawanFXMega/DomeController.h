@@ -0,0 +1,130 @@
+#ifndef DOME_CONTROLLER_H_
+#define DOME_CONTROLLER_H_
+
+#if (ARDUINO >= 100)
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <ArduinoLog.h>
+
+#include "MotorArbiter.h"
+#include "libs/DomePid/DomePid.h"
+#include "libs/DomePid/DomeTuning.h"
+
+// Set to true once a dome encoder and home sensor are fitted, without them the dome stays open
+// loop and automation falls back to timed turns.
+#define DOME_HAS_POSITION_SENSOR false
+// Runs the controller against the DomePlant model instead of the encoder, for tuning on the bench
+// with the dome motor disconnected.  Needs DOME_HAS_POSITION_SENSOR set to true.
+//#define DOME_SIMULATED_PLANT
+
+// Quadrature encoder channel A must be on an interrupt pin, B is read in the ISR.  The home
+// sensor (hall effect, active low) is sampled on every encoder edge, the dome is re-indexed on
+// every pass over it in the homing direction (the encoder counting up).  The encoder resolution
+// and the PID gains are in libs/DomePid/DomeTuning.h.
+#define DOME_ENCODER_A_PIN 2
+#define DOME_ENCODER_B_PIN 3
+#define DOME_HOME_PIN 4
+#define DOME_ENCODER_REVERSED false
+// angle of the home sensor from the front of the droid, positive is clockwise seen from above
+#define DOME_HOME_ANGLE 0
+
+// positive, homing has to turn the dome the way the encoder counts up
+#define DOME_HOMING_SPEED 25
+#define DOME_HOMING_TIMEOUT_MS 15000
+
+// lifetime of each motor request, the controller re-posts on every loop while it is moving
+#define DOME_REQUEST_TTL_MS 250
+
+enum DomeMode : uint8_t {
+  DOME_UNHOMED = 0,
+  DOME_HOMING,
+  DOME_IDLE,
+  DOME_MANUAL,
+  DOME_POSITIONING,
+  DOME_SPINNING
+};
+
+class DomeController {
+
+  private:
+    MotorArbiter* arbiter = NULL;
+    DomeAxis axis = DomeAxis(DOME_TICKS_PER_REV, DOME_KP, DOME_KI, DOME_KD, DOME_MAX_SPEED, DOME_MIN_SPEED,
+                             DOME_TOLERANCE_TICKS, DOME_SETTLE_PERIODS);
+#ifdef DOME_SIMULATED_PLANT
+    DomePlant plant = DomePlant(DOME_TICKS_PER_REV, DOME_MODEL_TICKS_PER_SEC, DOME_MODEL_TAU_MS, DOME_MODEL_STICTION,
+                                DOME_TICKS_PER_REV / 3);
+#endif
+    DomeMode mode = DOME_UNHOMED;
+    boolean isHomed = false;
+    int16_t targetAngle = 0;
+    int8_t manualThrottle = 0;
+    int8_t spinThrottle = 0;
+    int8_t output = 0;
+    // the source a move was commanded by, and the one the current request was posted under
+    MotorSource moveSource = MOTOR_SRC_SEQUENCE;
+    MotorSource postedSource = MOTOR_SRC_SEQUENCE;
+    boolean isPosted = false;
+    unsigned long lastPidMillis = 0;
+    unsigned long modeMillis = 0;
+    uint16_t spinDuration = 0;
+
+    DomeController();
+    DomeController(DomeController const&); // copy disabled
+    void operator=(DomeController const&); // assigment disabled
+    int32_t readTicks();
+    void setMode(DomeMode mode);
+    void runPid();
+    void runHoming();
+    void reindex();
+    void postOutput();
+
+  public:
+    static DomeController* getInstance();
+
+    /**
+     * Attaches the encoder and sets the arbiter the dome motor requests are posted to.
+     */
+    void setup(MotorArbiter* arbiter);
+
+    /**
+     * Turns the dome slowly until the home sensor is seen, then faces it forward.  Does nothing
+     * if there is no position sensor.
+     */
+    void home();
+
+    /**
+     * Stick input, anything other than 0 takes over from homing, a positioning move or a timed spin.
+     */
+    void setManualThrottle(int8_t throttle);
+
+    /**
+     * Turns the dome to an absolute angle in degrees, 0 is forward and positive is clockwise seen
+     * from above.  Returns false if the dome hasn't been homed.
+     */
+    boolean moveTo(int16_t degrees, MotorSource source = MOTOR_SRC_SEQUENCE);
+    boolean faceForward(MotorSource source = MOTOR_SRC_SEQUENCE);
+
+    /**
+     * Open loop turn at speed for the given time, used when the dome has no position.
+     */
+    void spin(int8_t speed, uint16_t duration, MotorSource source = MOTOR_SRC_AUTOMATION);
+
+    /**
+     * Stops the dome and aborts homing, positioning or spinning.
+     */
+    void stop();
+
+    boolean hasPosition();
+    boolean isMoving();
+    int16_t getAngle();
+    int16_t getTargetAngle();
+
+    /**
+     * Runs homing, the PID and timed spins and posts the resulting request, call on every loop.
+     */
+    void loop();
+};
+#endif //DOME_CONTROLLER_H_
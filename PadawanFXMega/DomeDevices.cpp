@@ -0,0 +1,87 @@
+#include "DomeDevices.h"
+
+typedef struct
+{
+  uint8_t address;
+  uint8_t maxCmd;
+} DomeDeviceInfo;
+
+static const DomeDeviceInfo DEVICES[DOME_DEV_COUNT] PROGMEM = {
+  { PERISCOPE_ADDRESS, PERISCOPE_CMD_MAX },
+  { TEECES_ADDRESS, TEECES_CMD_MAX },
+  { HP_FRONT_ADDRESS, HP_CMD_MAX },
+  { HP_REAR_ADDRESS, HP_CMD_MAX },
+  { HP_TOP_ADDRESS, HP_CMD_MAX }
+};
+
+DomeDevices::DomeDevices() {}
+
+DomeDevices* DomeDevices::getInstance() {
+  static DomeDevices devices;
+  return &devices;
+}
+
+boolean DomeDevices::queue(DomeDeviceId dev, uint8_t cmd, boolean force) {
+  if (dev >= DOME_DEV_COUNT || cmd > pgm_read_byte(&DEVICES[dev].maxCmd)) {
+    Log.warning(F("Invalid command: %d for dome device: %d"CR), cmd, dev);
+    return false;
+  }
+
+  if (!force && cmd == states[dev].lastSent) {
+    // already in that state, drop anything else queued so the device stays where it is
+    states[dev].pending = DOME_NO_STATE;
+    pendingMask &= ~_BV(dev);
+    suppressed++;
+    return true;
+  }
+  states[dev].pending = cmd;
+  pendingMask |= _BV(dev);
+  return true;
+}
+
+void DomeDevices::queueGroup(uint8_t mask, uint8_t cmd) {
+  for (uint8_t dev = 0; dev < DOME_DEV_COUNT; dev++) {
+    if (mask & _BV(dev)) {
+      queue((DomeDeviceId) dev, cmd);
+    }
+  }
+}
+
+void DomeDevices::flush() {
+  if (pendingMask == 0) {
+    return;
+  }
+
+  for (uint8_t dev = 0; dev < DOME_DEV_COUNT; dev++) {
+    if (!(pendingMask & _BV(dev))) {
+      continue;
+    }
+    uint8_t address = pgm_read_byte(&DEVICES[dev].address);
+    uint8_t cmd = states[dev].pending;
+    Wire.beginTransmission(address);
+    Wire.write(cmd);
+    if (Wire.endTransmission() == 0) {
+      states[dev].lastSent = cmd;
+      sent++;
+      Log.notice(F("Sent command: %d to device ID: %d"CR), cmd, address);
+    } else {
+      // state is unknown now, the next command goes out even if it matches
+      states[dev].lastSent = DOME_NO_STATE;
+      Log.warning(F("No ack for command: %d from device ID: %d"CR), cmd, address);
+    }
+    states[dev].pending = DOME_NO_STATE;
+  }
+  pendingMask = 0;
+}
+
+uint8_t DomeDevices::getState(DomeDeviceId dev) {
+  return states[dev].lastSent;
+}
+
+boolean DomeDevices::report(uint8_t line) {
+  if (line != 0) {
+    return false;
+  }
+  Log.notice(F("Dome I2C: %l sent, %l suppressed"CR), sent, suppressed);
+  return true;
+}
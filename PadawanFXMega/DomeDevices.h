@@ -0,0 +1,105 @@
+#ifndef DOME_DEVICES_H_
+#define DOME_DEVICES_H_
+
+#if (ARDUINO >= 100)
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <Wire.h>
+#include <ArduinoLog.h>
+
+// I2C addresses of the boards in the dome
+#define PERISCOPE_ADDRESS 0x20
+#define TEECES_ADDRESS 10
+#define HP_FRONT_ADDRESS 25
+#define HP_REAR_ADDRESS 26
+#define HP_TOP_ADDRESS 27
+
+// Periscope commands
+// 0: DO NOTHING - ALLOW I2C TO TAKE CONTROL
+// 1: DOWN POSITION - ALL OFF
+// 2: FAST UP - RANDOM LIGHTS
+// 3: SEARCHLIGHT - CCW
+// 4: RANDOM - FAST
+// 5: RANDOM - SLOW
+// 6: DAGOBAH - WHITE LIGHTS - FACE FORWARD
+// 7: SEARCHLIGHT CW
+#define PERISCOPE_CMD_MAX 7
+#define PERISCOPE_DOWN 1
+
+// Teeces and HP event numbers, these need to match the sketches flashed on the dome boards
+#define TEECES_CMD_MAX 9
+#define HP_CMD_MAX 9
+#define HP_CMD_OFF 0
+
+// state of a device that hasn't acknowledged a command yet
+#define DOME_NO_STATE 0xFF
+
+enum DomeDeviceId : uint8_t {
+  DOME_DEV_PERISCOPE = 0,
+  DOME_DEV_TEECES,
+  DOME_DEV_HP_FRONT,
+  DOME_DEV_HP_REAR,
+  DOME_DEV_HP_TOP,
+  DOME_DEV_COUNT
+};
+
+// device groups for queueGroup()
+#define DOME_GROUP_HPS (_BV(DOME_DEV_HP_FRONT) | _BV(DOME_DEV_HP_REAR) | _BV(DOME_DEV_HP_TOP))
+#define DOME_GROUP_ALL ((1 << DOME_DEV_COUNT) - 1)
+
+/**
+   Registry of the I2C boards in the dome.  Commands are queued during the loop and sent back to
+   back by a single flush(), a command that matches what the device was last sent is dropped so
+   repeated button presses don't put anything on the bus.
+*/
+class DomeDevices {
+
+    typedef struct
+    {
+      uint8_t lastSent = DOME_NO_STATE;
+      uint8_t pending = DOME_NO_STATE;
+    } DeviceState;
+
+  private:
+    DeviceState states[DOME_DEV_COUNT];
+    uint8_t pendingMask = 0;
+    unsigned long sent = 0;
+    unsigned long suppressed = 0;
+
+    DomeDevices();
+    DomeDevices(DomeDevices const&); // copy disabled
+    void operator=(DomeDevices const&); // assigment disabled
+
+  public:
+    static DomeDevices* getInstance();
+
+    /**
+     * Queues a command for a device, returns false if the command is outside the device's command
+     * set.  Unless forced, a command equal to the device's current state is not sent.
+     */
+    boolean queue(DomeDeviceId dev, uint8_t cmd, boolean force = false);
+
+    /**
+     * Queues the same command for every device in the mask, e.g. DOME_GROUP_HPS.
+     */
+    void queueGroup(uint8_t mask, uint8_t cmd);
+
+    /**
+     * Sends every queued command, one transaction per device in a single pass.  Call once per loop.
+     */
+    void flush();
+
+    /**
+     * The last command the device acknowledged, DOME_NO_STATE if unknown.
+     */
+    uint8_t getState(DomeDeviceId dev);
+
+    /**
+     * Logs the single line report when line is 0, returns false for any other line.
+     */
+    boolean report(uint8_t line);
+};
+#endif //DOME_DEVICES_H_
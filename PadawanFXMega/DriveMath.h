@@ -0,0 +1,42 @@
+#ifndef DRIVE_MATH_H_
+#define DRIVE_MATH_H_
+
+#if (ARDUINO >= 100)
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+/**
+   The stick to motor math from drive(), kept free of the controller and the motor controllers so
+   the benchmark sketch can time exactly what the droid runs.
+*/
+
+/**
+ * Maps a signed 16 bit Xbox 360 stick value to -speed..speed, 0 inside the dead zone.
+ */
+inline char stick_to_throttle(int16_t hat, int neutral, byte speed) {
+  if (abs((long) hat) > neutral) {
+    return map(hat, -32768, 32767, -speed, speed);
+  }
+  return 0;
+}
+
+/**
+ * Moves throttle at most ramping steps towards target.
+ */
+inline char ramp_throttle(char throttle, char target, byte ramping) {
+  if (throttle < target) {
+    if (target - throttle < (ramping + 1)) {
+      return target;
+    }
+    return throttle + ramping;
+  } else if (throttle > target) {
+    if (throttle - target < (ramping + 1)) {
+      return target;
+    }
+    return throttle - ramping;
+  }
+  return throttle;
+}
+#endif //DRIVE_MATH_H_
@@ -0,0 +1,191 @@
+#include <avr/wdt.h>
+#include <util/atomic.h>
+
+#include "LoopWatchdog.h"
+
+#define WD_RESET_MAGIC 0xD2
+
+// survives a watchdog reset so the stage that hung can be reported on the next boot
+uint8_t wdResetMagic __attribute__ ((section (".noinit")));
+uint8_t wdResetStage __attribute__ ((section (".noinit")));
+uint8_t wdMcusr __attribute__ ((section (".noinit")));
+
+// Runs before main(), the watchdog stays enabled across a reset and has to be turned off before
+// the core gets a chance to hang in setup.
+void wd_init3() __attribute__ ((naked, used, section (".init3")));
+void wd_init3() {
+  wdMcusr = MCUSR;
+  MCUSR = 0;
+  wdt_disable();
+}
+
+static const uint16_t STAGE_BUDGETS_MS[STAGE_COUNT] PROGMEM = {
+  WD_BUDGET_IDLE_MS,
+  WD_BUDGET_USB_MS,
+  WD_BUDGET_BOOT_MS,
+  WD_BUDGET_FAILSAFE_MS,
+  WD_BUDGET_BUTTONS_MS,
+  WD_BUDGET_DRIVE_MS,
+  WD_BUDGET_DISCONNECT_MS,
+  WD_BUDGET_AUTOMATION_MS,
+  WD_BUDGET_DOME_MS,
+  WD_BUDGET_MOTORS_MS,
+  WD_BUDGET_I2C_MS,
+  WD_BUDGET_SERVOS_MS,
+  WD_BUDGET_REPORT_MS
+};
+
+static const char STAGE_NAMES[STAGE_COUNT][11] PROGMEM = {
+  "idle", "usb", "boot", "failsafe", "buttons", "drive", "disconnect", "automation", "dome", "motors", "i2c", "servos", "report"
+};
+
+// trips are counted from the ISR, kept apart from the stats the loop updates
+static volatile uint16_t stageTrips[STAGE_COUNT];
+
+#if defined(UDR1) && defined(UDR2)
+/**
+   Writes a single packet serial command straight into the USART, polling the data register so it
+   works with interrupts disabled.  Any bytes still queued in the HardwareSerial buffer follow
+   afterwards, the controllers resync on the address byte so a cut packet is simply dropped.
+*/
+static void send_stop_packet(volatile uint8_t* ucsra, volatile uint8_t* udr, uint8_t address, uint8_t command) {
+  uint8_t packet[4] = { address, command, 0, (uint8_t) ((address + command) & 0x7F) };
+  for (uint8_t i = 0; i < 4; i++) {
+    // UDRE sits on the same bit for every USART
+    while (!(*ucsra & _BV(UDRE0)));
+    *udr = packet[i];
+  }
+}
+#endif
+
+ISR(WDT_vect) {
+  LoopWatchdog::getInstance()->onWatchdogTick();
+}
+
+LoopWatchdog::LoopWatchdog() {}
+
+LoopWatchdog* LoopWatchdog::getInstance() {
+  static LoopWatchdog wd;
+  return &wd;
+}
+
+void LoopWatchdog::setup() {
+  if ((wdMcusr & _BV(WDRF)) && wdResetMagic == WD_RESET_MAGIC && wdResetStage < STAGE_COUNT) {
+    char name[11];
+    strcpy_P(name, STAGE_NAMES[wdResetStage]);
+    Log.error(F("Watchdog reset, stage hung: %s"CR), name);
+  }
+  wdResetMagic = 0;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    currStage = STAGE_IDLE;
+    stageStartMicros = micros();
+    isStageTripped = false;
+    isArmed = true;
+  }
+  loopStartMicros = micros();
+
+  // interrupt + reset mode, the ISR re-arms the interrupt on each tick
+  wdt_enable(WDTO_15MS);
+  WDTCSR |= _BV(WDIE);
+  Log.notice(F("Loop watchdog armed."CR));
+}
+
+void LoopWatchdog::closeStage(unsigned long now) {
+  uint8_t stage = currStage;
+  unsigned long elapsed = now - stageStartMicros;
+  if (elapsed > stats[stage].maxMicros) {
+    stats[stage].maxMicros = elapsed;
+  }
+  if (elapsed > pgm_read_word(&STAGE_BUDGETS_MS[stage]) * 1000UL) {
+    stats[stage].overruns++;
+  }
+}
+
+void LoopWatchdog::beginStage(LoopStage stage) {
+  unsigned long now = micros();
+  closeStage(now);
+
+  if (stage == STAGE_USB) {
+    unsigned long loopMicros = now - loopStartMicros;
+    if (loops > 0 && loopMicros > maxLoopMicros) {
+      maxLoopMicros = loopMicros;
+    }
+    loopStartMicros = now;
+    loops++;
+  }
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    currStage = stage;
+    stageStartMicros = now;
+    isStageTripped = false;
+  }
+}
+
+boolean LoopWatchdog::tookControl() {
+  boolean tookControl = false;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    if (pendingTrips > 0) {
+      pendingTrips = 0;
+      tookControl = true;
+    }
+  }
+  return tookControl;
+}
+
+boolean LoopWatchdog::report(uint8_t line) {
+  if (line == 0) {
+    unsigned long reaction;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+      reaction = maxReactionMicros;
+    }
+    Log.notice(F("Loop watchdog: %l loops, worst loop %l us, worst reaction %l us"CR), loops, maxLoopMicros, reaction);
+    return true;
+  }
+  uint8_t stage = line - 1;
+  if (stage >= STAGE_COUNT) {
+    return false;
+  }
+  char name[11];
+  uint16_t trips;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    trips = stageTrips[stage];
+  }
+  strcpy_P(name, STAGE_NAMES[stage]);
+  Log.notice(F(" -- %s: worst %l us, budget %d ms, overruns %d, trips %d"CR), name, stats[stage].maxMicros,
+             pgm_read_word(&STAGE_BUDGETS_MS[stage]), stats[stage].overruns, trips);
+  return true;
+}
+
+void LoopWatchdog::onWatchdogTick() {
+  if (!isArmed) {
+    return;
+  }
+
+  uint8_t stage = currStage;
+  unsigned long elapsed = micros() - stageStartMicros;
+  unsigned long budget = pgm_read_word(&STAGE_BUDGETS_MS[stage]) * 1000UL;
+
+  if (elapsed > budget && !isStageTripped) {
+    isStageTripped = true;
+#if defined(UDR1) && defined(UDR2)
+    // Sabertooth on Serial1: mixed mode drive(0) and turn(0), Syren on Serial2: motor(1, 0)
+    send_stop_packet(&UCSR1A, &UDR1, WD_ST_ADDRESS, 8);
+    send_stop_packet(&UCSR1A, &UDR1, WD_ST_ADDRESS, 10);
+    send_stop_packet(&UCSR2A, &UDR2, WD_SYREN_ADDRESS, 0);
+#endif
+    stageTrips[stage]++;
+    pendingTrips++;
+    if (elapsed - budget > maxReactionMicros) {
+      maxReactionMicros = elapsed - budget;
+    }
+  }
+
+  if (WD_ALLOW_RESET && elapsed > WD_HARD_LIMIT_MS * 1000UL) {
+    // leave WDIE cleared, the next timeout resets the board
+    wdResetMagic = WD_RESET_MAGIC;
+    wdResetStage = stage;
+    return;
+  }
+  WDTCSR |= _BV(WDIE);
+}
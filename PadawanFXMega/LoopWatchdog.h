@@ -0,0 +1,117 @@
+#ifndef LOOP_WATCHDOG_H_
+#define LOOP_WATCHDOG_H_
+
+#if (ARDUINO >= 100)
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <ArduinoLog.h>
+
+// The AVR watchdog is run in interrupt + reset mode as a 15ms supervisor tick.  Each tick checks
+// how long the current loop stage has been running, once a stage goes past its deadline the motors
+// are stopped straight from the ISR.  If a stage stays stuck past WD_HARD_LIMIT_MS the ISR stops
+// re-arming itself and the next tick resets the board.
+//
+// NOTE: older Mega2560 bootloaders do not clear the watchdog and will loop on a watchdog reset,
+// set WD_ALLOW_RESET to false if the board has one of those.
+#define WD_ALLOW_RESET true
+#define WD_HARD_LIMIT_MS 4000
+
+// Per stage deadlines in millis, the watchdog tick makes these accurate to ~15ms.
+#define WD_BUDGET_IDLE_MS 30
+#define WD_BUDGET_USB_MS 60
+#define WD_BUDGET_BOOT_MS 30
+#define WD_BUDGET_FAILSAFE_MS 30
+#define WD_BUDGET_BUTTONS_MS 60
+#define WD_BUDGET_DRIVE_MS 30
+#define WD_BUDGET_DISCONNECT_MS 30
+#define WD_BUDGET_AUTOMATION_MS 60
+#define WD_BUDGET_DOME_MS 30
+#define WD_BUDGET_MOTORS_MS 30
+#define WD_BUDGET_I2C_MS 30
+#define WD_BUDGET_SERVOS_MS 60
+// one line of diagnostics per loop, a line fills the serial buffer and blocks for ~10ms at most
+#define WD_BUDGET_REPORT_MS 30
+
+// Packet serial addresses the ISR uses when forcing the motors to stop.
+#define WD_ST_ADDRESS 128
+#define WD_SYREN_ADDRESS 128
+
+enum LoopStage : uint8_t {
+  STAGE_IDLE = 0,
+  STAGE_USB,
+  STAGE_BOOT,
+  STAGE_FAILSAFE,
+  STAGE_BUTTONS,
+  STAGE_DRIVE,
+  STAGE_DISCONNECT,
+  STAGE_AUTOMATION,
+  STAGE_DOME,
+  STAGE_MOTORS,
+  STAGE_I2C,
+  STAGE_SERVOS,
+  STAGE_REPORT,
+  STAGE_COUNT
+};
+
+class LoopWatchdog {
+
+    typedef struct
+    {
+      unsigned long maxMicros = 0;
+      uint16_t overruns = 0;
+      uint16_t trips = 0;
+    } StageStats;
+
+  private:
+    StageStats stats[STAGE_COUNT];
+    unsigned long loopStartMicros = 0;
+    unsigned long maxLoopMicros = 0;
+    unsigned long loops = 0;
+
+    volatile uint8_t currStage = STAGE_IDLE;
+    volatile unsigned long stageStartMicros = 0;
+    volatile boolean isStageTripped = false;
+    volatile boolean isArmed = false;
+    volatile uint16_t pendingTrips = 0;
+    volatile unsigned long maxReactionMicros = 0;
+
+    LoopWatchdog();
+    LoopWatchdog(LoopWatchdog const&); // copy disabled
+    void operator=(LoopWatchdog const&); // assigment disabled
+    void closeStage(unsigned long now);
+
+  public:
+    static LoopWatchdog* getInstance();
+
+    /**
+     * Arms the hardware watchdog and reports if the last reset was caused by it.  Call at the end
+     * of setup(), once the motor serial ports have been started.
+     */
+    void setup();
+
+    /**
+     * Marks the start of a loop stage, closing out the timing of the previous one.  Starting the
+     * USB stage also marks the start of a new loop.
+     */
+    void beginStage(LoopStage stage);
+
+    /**
+     * Returns true once for every time the ISR had to force the motors safe since the last call.
+     */
+    boolean tookControl();
+
+    /**
+     * Logs one line of the worst case timing and the overrun/trip counts, the totals first and
+     * then one per stage.  Returns false once line is past the last one.
+     */
+    boolean report(uint8_t line);
+
+    /**
+     * Called by the watchdog ISR, not intended to be called directly.
+     */
+    void onWatchdogTick();
+};
+#endif //LOOP_WATCHDOG_H_
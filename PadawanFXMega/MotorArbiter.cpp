@@ -0,0 +1,93 @@
+#include "MotorArbiter.h"
+
+MotorArbiter::MotorArbiter() {}
+
+MotorArbiter* MotorArbiter::getInstance() {
+  static MotorArbiter arbiter;
+  return &arbiter;
+}
+
+void MotorArbiter::setup(Sabertooth* st, Sabertooth* syren) {
+  this->st = st;
+  this->syren = syren;
+}
+
+void MotorArbiter::post(MotorChannel channel, MotorSource source, int8_t value, uint16_t ttlMillis) {
+  requests[channel][source].value = value;
+  requests[channel][source].expiresMillis = millis() + ttlMillis;
+  requests[channel][source].isActive = true;
+}
+
+void MotorArbiter::release(MotorChannel channel, MotorSource source) {
+  requests[channel][source].isActive = false;
+}
+
+void MotorArbiter::failsafe(uint16_t ttlMillis) {
+  for (uint8_t channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++) {
+    post((MotorChannel) channel, MOTOR_SRC_FAILSAFE, 0, ttlMillis);
+  }
+}
+
+void MotorArbiter::invalidate() {
+  for (uint8_t channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++) {
+    outputs[channel].isSent = false;
+  }
+}
+
+void MotorArbiter::send(MotorChannel channel, int8_t value) {
+  switch (channel) {
+    case MOTOR_DRIVE:
+      st->drive(value);
+      break;
+    case MOTOR_TURN:
+      st->turn(value);
+      break;
+    case MOTOR_DOME:
+      syren->motor(1, value);
+      break;
+    default:
+      break;
+  }
+}
+
+void MotorArbiter::resolve() {
+  unsigned long now = millis();
+
+  for (uint8_t channel = 0; channel < MOTOR_CHANNEL_COUNT; channel++) {
+    // highest priority live request wins, nobody asking means stop
+    int8_t value = 0;
+    for (int8_t source = MOTOR_SOURCE_COUNT - 1; source >= 0; source--) {
+      MotorRequest* request = &requests[channel][source];
+      if (request->isActive && (long) (now - request->expiresMillis) >= 0) {
+        request->isActive = false;
+      }
+      if (request->isActive) {
+        value = request->value;
+        break;
+      }
+    }
+
+    MotorOutput* output = &outputs[channel];
+    if (output->isSent && output->value == value && now - output->sentMillis < MOTOR_REFRESH_MS) {
+      suppressed++;
+      continue;
+    }
+    send((MotorChannel) channel, value);
+    output->value = value;
+    output->isSent = true;
+    output->sentMillis = now;
+    sent++;
+  }
+}
+
+int8_t MotorArbiter::getOutput(MotorChannel channel) {
+  return outputs[channel].value;
+}
+
+boolean MotorArbiter::report(uint8_t line) {
+  if (line != 0) {
+    return false;
+  }
+  Log.notice(F("Motor arbiter: %l commands sent, %l duplicates suppressed"CR), sent, suppressed);
+  return true;
+}
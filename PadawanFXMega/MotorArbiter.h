@@ -0,0 +1,119 @@
+#ifndef MOTOR_ARBITER_H_
+#define MOTOR_ARBITER_H_
+
+#if (ARDUINO >= 100)
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <ArduinoLog.h>
+#include <Sabertooth.h>
+
+// resend an unchanged command this often so the 900ms motor controller timeout doesn't kick in
+#define MOTOR_REFRESH_MS 100
+// the stick is only re-read every INPUT_REFRESH_MILLIS on a steady controller, its requests have
+// to outlive that
+#define MOTOR_STICK_TTL_MS 250
+#define MOTOR_FAILSAFE_TTL_MS 100
+
+enum MotorChannel : uint8_t {
+  MOTOR_DRIVE = 0,
+  MOTOR_TURN,
+  MOTOR_DOME,
+  MOTOR_CHANNEL_COUNT
+};
+
+// in order of priority, lowest first, the operator always wins over anything automated and the
+// failsafe wins over everything
+enum MotorSource : uint8_t {
+  MOTOR_SRC_AUTOMATION = 0,
+  MOTOR_SRC_SEQUENCE,
+  MOTOR_SRC_STICK,
+  MOTOR_SRC_FAILSAFE,
+  MOTOR_SOURCE_COUNT
+};
+
+/**
+   Every part of the sketch that wants to move a motor posts a request with its source and an
+   expiry instead of writing to the motor controllers.  Once per loop resolve() picks the highest
+   priority live request for each motor and sends it, a motor nobody is asking for is stopped.
+   Commands that match what the controller was last sent are only repeated to keep it alive.
+
+   The watchdog ISR is the one exception, it writes its stop packets straight to the serial ports
+   and the loop calls invalidate() afterwards.
+*/
+class MotorArbiter {
+
+    typedef struct
+    {
+      int8_t value = 0;
+      unsigned long expiresMillis = 0;
+      boolean isActive = false;
+    } MotorRequest;
+
+    typedef struct
+    {
+      int8_t value = 0;
+      boolean isSent = false;
+      unsigned long sentMillis = 0;
+    } MotorOutput;
+
+  private:
+    Sabertooth* st = NULL;
+    Sabertooth* syren = NULL;
+    MotorRequest requests[MOTOR_CHANNEL_COUNT][MOTOR_SOURCE_COUNT];
+    MotorOutput outputs[MOTOR_CHANNEL_COUNT];
+    unsigned long sent = 0;
+    unsigned long suppressed = 0;
+
+    MotorArbiter();
+    MotorArbiter(MotorArbiter const&); // copy disabled
+    void operator=(MotorArbiter const&); // assigment disabled
+    void send(MotorChannel channel, int8_t value);
+
+  public:
+    static MotorArbiter* getInstance();
+
+    /**
+     * Sets the Sabertooth (drive and turn, mixed mode) and the Syren (dome) the commands go to.
+     */
+    void setup(Sabertooth* st, Sabertooth* syren);
+
+    /**
+     * Asks for a motor to run at value (-127 to 127) for the next ttlMillis, replacing any earlier
+     * request from the same source.
+     */
+    void post(MotorChannel channel, MotorSource source, int8_t value, uint16_t ttlMillis);
+
+    /**
+     * Withdraws a source's request before it expires.
+     */
+    void release(MotorChannel channel, MotorSource source);
+
+    /**
+     * Stops every motor with a failsafe request that outranks everything else.
+     */
+    void failsafe(uint16_t ttlMillis);
+
+    /**
+     * Forgets what the motor controllers were last sent, the next resolve() sends every motor.
+     */
+    void invalidate();
+
+    /**
+     * Sends exactly one resolved command per motor, call once per loop.
+     */
+    void resolve();
+
+    /**
+     * The value last sent to a motor.
+     */
+    int8_t getOutput(MotorChannel channel);
+
+    /**
+     * Logs the single line report when line is 0, returns false for any other line.
+     */
+    boolean report(uint8_t line);
+};
+#endif //MOTOR_ARBITER_H_
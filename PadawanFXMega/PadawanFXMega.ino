@@ -58,6 +58,15 @@
 #include "Sounds.h"
 #include "PadawanFXConfig.h"
 #include "UA.h"
+#include "LoopWatchdog.h"
+#include "XboxInput.h"
+#include "DomeController.h"
+#include "DomeDevices.h"
+#include "SoundBanks.h"
+#include "BootSequence.h"
+#include "MotorArbiter.h"
+#include "SoundPlayer.h"
+#include "DriveMath.h"
 #include "Utility.h"
 
 // need to include headers and impl in the ino to get around Arduino IDE compile issues
@@ -65,6 +74,8 @@
 #include "libs/TimedServos/TimedServos.cpp"
 #include "libs/WavTrigger2/WavTrigger2.h"
 #include "libs/WavTrigger2/WavTrigger2.cpp"
+#include "libs/DomePid/DomePid.h"
+#include "libs/DomePid/DomePid.cpp"
 
 
 Sabertooth Sabertooth2xXX(128, Serial1);
@@ -79,21 +90,39 @@ boolean isDriveEnabled = false;
 // Automated function variables
 // Used as a boolean to turn on/off automated functions like periodic random sounds and periodic dome turns
 boolean isInAutomationMode = false;
-boolean isBgMusicPlaying = false;
 unsigned long automateMillis = 0;
 byte automateDelay = random(5, 20); // set this to min and max seconds between sounds
 
-//How much the dome may turn during automation.
+//How much the dome may turn during automation, in degrees when the dome has a position sensor,
+// otherwise the speed of a timed turn.
 int turnDirection = 20;
+// How long the dome spins for each automated turn without a position sensor.
+const uint16_t AUTO_TURN_MILLIS = 750;
 
 // Action number used to randomly choose a sound effect or a dome turn
 byte automateAction = 0;
 char driveThrottle = 0;
 char sticknum = 0;
+// true until driveThrottle has caught up with the stick
+boolean isDriveRamping = false;
 char domeThrottle = 0;
 char turnThrottle = 0;
 long xboxBtnPressedSince = 0;
 boolean firstLoadOnConnect = false;
+
+// The XBOX button diagnostics are printed one line per loop, the whole report would block the
+// loop on the serial port long enough to trip the watchdog.
+enum DiagSection : uint8_t {
+  DIAG_BATTERY = 0,
+  DIAG_INPUT,
+  DIAG_DOME_I2C,
+  DIAG_MOTORS,
+  DIAG_BOOT,
+  DIAG_WATCHDOG,
+  DIAG_DONE
+};
+DiagSection diagSection = DIAG_DONE;
+uint8_t diagLine = 0;
 boolean periscopeUp = false;
 boolean periscopeRandomFast = false; //5, then 4
 boolean periscopeSearchLightCCW = false; // send 7, then 3
@@ -102,23 +131,37 @@ USB Usb;
 XBOXRECV Xbox(&Usb);
 TimedServos* ts = TimedServos::getInstance();
 UA* ua = UA::getInstance();
+LoopWatchdog* wd = LoopWatchdog::getInstance();
+XboxInput* input = XboxInput::getInstance();
+DomeController* dome = DomeController::getInstance();
+DomeDevices* domeDevs = DomeDevices::getInstance();
+SoundBanks* sndBanks = SoundBanks::getInstance();
+BootSequence* boot = BootSequence::getInstance();
+MotorArbiter* arbiter = MotorArbiter::getInstance();
+SoundPlayer* player = SoundPlayer::getInstance();
+unsigned long audioQueryMillis = 0;
 
+/**
+   Starts every subsystem without waiting on any of them.  The motors are stopped first, the WAV
+   Trigger queries are answered in the background by boot_audio() and the loop holds the motors
+   safe until the BootSequence reports every stage done.
+*/
 void setup() {
+  boot->begin(BOOT_SERIAL);
   Serial.begin(115200);
   // Wait for serial port to connect - used on Leonardo, Teensy and other boards with built-in USB CDC serial connection
-  while (!Serial);
+  if (BOOT_WAIT_FOR_SERIAL) {
+    while (!Serial && millis() < BOOT_SERIAL_WAIT_MS);
+  }
   Wire.begin();
   // use fast IIC
   //TWBR = 12; // upgrade to 400KHz!
   // Initialize with log level and log output.
   Log.begin(LOG_LEVEL_VERBOSE, &Serial, true);
   Log.verbose(F("PadawanFX"CR));
+  boot->done(BOOT_SERIAL);
 
-  if (Usb.Init() == -1) {
-    Log.fatal(F("\r\nOSC did not start"CR));
-    while (1); //halt
-  }
-
+  boot->begin(BOOT_MOTORS);
   Serial2.begin(DOMEBAUDRATE);
   Syren10.setTimeout(900);
 
@@ -134,49 +177,159 @@ void setup() {
   // The Sabertooth won't act on mixed mode packet serial commands until
   // it has received power levels for BOTH throttle and turning, since it
   // mixes the two together to get diff-drive power levels for both motors.
-  Sabertooth2xXX.drive(0);
-  Sabertooth2xXX.turn(0);
+  arbiter->setup(&Sabertooth2xXX, &Syren10);
+  arbiter->failsafe(MOTOR_FAILSAFE_TTL_MS);
+  arbiter->resolve();
+  dome->setup(arbiter);
+  boot->done(BOOT_MOTORS);
 
-  // WAV Trigger startup
+  boot->begin(BOOT_USB);
+  if (Usb.Init() == -1) {
+    Log.fatal(F("\r\nOSC did not start"CR));
+    while (1); //halt
+  }
+  input->setup(&Usb, &Xbox);
+  // the receiver enumerates in the background through Usb.Task(), the stage is done once it is up
+
+  // WAV Trigger startup, the version and system info come back while the loop runs
+  boot->begin(BOOT_AUDIO);
   Serial3.begin(WAVBAUDRATE);
   wTrig.setup(&Serial3);
+  player->setup(&wTrig);
   wTrig.stopAllTracks();
-  print_wav_info();
-  set_volume(vol);
+  wTrig.request(CMD_GET_VERSION);
+  audioQueryMillis = millis();
+
+  boot->begin(BOOT_SERVOS);
   ts->setup();
+  boot->done(BOOT_SERVOS);
+
+  wd->setup();
 }
 
 void loop() {
   // used in testing, keeps track of the number of cycles being run
   countCycles();
-  Usb.Task();
+  // the watchdog stopped the motors behind the arbiter's back, resend everything
+  if (wd->tookControl()) {
+    arbiter->invalidate();
+  }
+  wd->beginStage(STAGE_USB);
+  input->poll();
+  wd->beginStage(STAGE_BOOT);
+  if (!boot->isDone(BOOT_USB) && Xbox.XboxReceiverConnected) {
+    boot->done(BOOT_USB);
+  }
+  boot_audio();
 
   //if we're not connected, return so we don't bother doing anything else.
   // set all movement to 0 so if we lose connection we don't have a runaway droid!
   // a restraining bolt and jawa droid caller won't save us here!
-  if (!Xbox.XboxReceiverConnected || !Xbox.Xbox360Connected[0]) {
-    Sabertooth2xXX.drive(0);
-    Sabertooth2xXX.turn(0);
-    Syren10.motor(1, 0);
+  // The same goes for while we're still booting.
+  if (!boot->isReady() || !Xbox.XboxReceiverConnected || !Xbox.Xbox360Connected[0]) {
+    wd->beginStage(STAGE_FAILSAFE);
+    arbiter->failsafe(MOTOR_FAILSAFE_TTL_MS);
+    arbiter->resolve();
+    dome->stop();
+    input->reset();
     firstLoadOnConnect = false;
     xboxBtnPressedSince = 0;
+    diagSection = DIAG_DONE;
     return;
   }
 
+  wd->beginStage(STAGE_BUTTONS);
   // After the controller connects, Blink all the LEDs so we know drives are disengaged at start
   if (!firstLoadOnConnect) {
     firstLoadOnConnect = true;
     isDriveEnabled = false;
     play_sound_track(CONTROLLER_CONNECTED);
     Xbox.setLedMode(ROTATING, 0);
+    // home once someone is in control, a failed homing is retried on the next connect
+    if (!dome->hasPosition()) {
+      dome->home();
+    }
+  }
+
+  // only a new controller report can carry a button click
+  if (input->isFresh()) {
+    dispatch_buttons();
+  }
+
+  // re-map the sticks on new input, while the throttle is still ramping, or often enough to keep
+  // the motor controllers from timing out
+  wd->beginStage(STAGE_DRIVE);
+  if (input->isFresh() || isDriveRamping || input->isRefreshDue()) {
+    drive();
+    input->markRefreshed();
+  }
+  wd->beginStage(STAGE_DISCONNECT);
+  is_disconnect();
+  wd->beginStage(STAGE_AUTOMATION);
+  automation_mode();
+  wd->beginStage(STAGE_DOME);
+  dome->loop();
+  wd->beginStage(STAGE_MOTORS);
+  arbiter->resolve();
+  wd->beginStage(STAGE_I2C);
+  domeDevs->flush();
+  wd->beginStage(STAGE_SERVOS);
+  ts->loop();
+  wd->beginStage(STAGE_REPORT);
+  print_diagnostics();
+}
+
+/**
+   Prints the next line of the diagnostics report, if one was asked for.
+*/
+void print_diagnostics() {
+  while (diagSection != DIAG_DONE) {
+    boolean isPrinted = false;
+    switch (diagSection) {
+      case DIAG_BATTERY:
+        if (diagLine == 0) {
+          Log.notice(F("Xbox Battery Level: %d"CR), Xbox.getBatteryLevel(0));
+          isPrinted = true;
+        }
+        break;
+      case DIAG_INPUT:
+        isPrinted = input->report(diagLine);
+        break;
+      case DIAG_DOME_I2C:
+        isPrinted = domeDevs->report(diagLine);
+        break;
+      case DIAG_MOTORS:
+        isPrinted = arbiter->report(diagLine);
+        break;
+      case DIAG_BOOT:
+        isPrinted = boot->report(diagLine);
+        break;
+      case DIAG_WATCHDOG:
+        isPrinted = wd->report(diagLine);
+        break;
+      default:
+        break;
+    }
+    if (isPrinted) {
+      diagLine++;
+      return;
+    }
+    diagSection = (DiagSection) (diagSection + 1);
+    diagLine = 0;
   }
+}
 
+/**
+   Handles the button clicks and combos of the controller, only needs to run when a new report
+   has arrived.
+*/
+void dispatch_buttons() {
   // enable / disable right stick (droid movement) & play a sound to signal motor state
   if (Xbox.getButtonClick(START, 0)) {
     if (isDriveEnabled) {
       isDriveEnabled = false;
       Xbox.setLedMode(ROTATING, 0);
-      play_sound_track(random(HUM_SND_START, HUM_SND_END));
+      play_sound_track(sndBanks->next(SND_BANK_HUM));
     } else {
       isDriveEnabled = true;
       play_sound_track(PROC_SND_START);
@@ -199,7 +352,7 @@ void loop() {
       play_sound_track(PROC_SND_START);
     } else {
       isInAutomationMode = true;
-      play_sound_track(random(PROC_SND_START + 1, PROC_SND_END));
+      play_sound_track(sndBanks->next(SND_BANK_PROC_ALT));
     }
   }
 
@@ -246,6 +399,13 @@ void loop() {
         send_periscope_command(2);
       }
       periscopeUp = !periscopeUp;
+    } else if (Xbox.getButtonPress(L2, 0)) {
+      // quiet dome, all HPs off and periscope down, sent together on the next flush
+      domeDevs->queueGroup(DOME_GROUP_HPS, HP_CMD_OFF);
+      send_periscope_command(PERISCOPE_DOWN);
+      periscopeUp = false;
+      periscopeSearchLightCCW = false;
+      periscopeRandomFast = false;
     } else {
       // close utility arms
       ua->close_all();
@@ -255,7 +415,8 @@ void loop() {
   // LEFT on control pad
   if (Xbox.getButtonClick(LEFT, 0)) {
     if (Xbox.getButtonPress(R1, 0)) {
-
+      // dome look left
+      dome->moveTo(-90);
     } else if (Xbox.getButtonPress(L1, 0)) {
       if (periscopeRandomFast) {
         // periscope up/down
@@ -273,9 +434,11 @@ void loop() {
 
   // RIGHT on control pad
   if (Xbox.getButtonClick(RIGHT, 0)) {
-    //volume down
     if (Xbox.getButtonPress(R1, 0)) {
-
+      // dome face forward, or try homing again if it never found home
+      if (!dome->faceForward()) {
+        dome->home();
+      }
     } else if (Xbox.getButtonPress(L1, 0)) {
       if (periscopeSearchLightCCW) {
         // periscope up/down
@@ -294,30 +457,30 @@ void loop() {
   // Y Button and Y combo buttons
   if (Xbox.getButtonClick(Y, 0)) {
     if (Xbox.getButtonPress(L1, 0)) {
-      play_sound_track(random(LEIA_SND_START, LEIA_SND_END));
+      play_sound_track(sndBanks->next(SND_BANK_LEIA));
     } else if (Xbox.getButtonPress(L2, 0)) {
-      play_sound_track(random(SCREAM_SND_START, SCREAM_SND_END));
+      play_sound_track(sndBanks->next(SND_BANK_SCREAM));
     } else if (Xbox.getButtonPress(R1, 0)) {
       play_sound_track(SW_SND_THEME);
     } else if (Xbox.getButtonPress(R2, 0)) {
       play_sound_track(PATROL_SND);
     } else {
-      play_sound_track(random(HUM_SND_START, HUM_SND_END));
+      play_sound_track(sndBanks->next(SND_BANK_HUM));
     }
   }
 
   // X Button and X combo Buttons
   if (Xbox.getButtonClick(X, 0)) {
     if (Xbox.getButtonPress(L1, 0)) {
-      play_sound_track(random(CHAT_SND_START, CHAT_SND_END));
+      play_sound_track(sndBanks->next(SND_BANK_CHAT));
     } else if (Xbox.getButtonPress(L2, 0)) {
-      play_sound_track(random(WHISTLE_SND_START, WHISTLE_SND_END));
+      play_sound_track(sndBanks->next(SND_BANK_WHISTLE));
     } else if (Xbox.getButtonPress(R1, 0)) {
       play_sound_track(EMPIRE_SND_THEME);
     } else if (Xbox.getButtonPress(R2, 0)) {
-      play_sound_track(random(HOLIDAY_MUS_START, HOLIDAY_MUS_END));
+      play_sound_track(sndBanks->next(SND_BANK_HOLIDAY_MUS));
     } else {
-      play_sound_track(random(GEN_SND_START, GEN_SND_END));
+      play_sound_track(sndBanks->next(SND_BANK_GEN));
     }
   }
 
@@ -330,30 +493,31 @@ void loop() {
     } else if (Xbox.getButtonPress(R1, 0)) {
       play_sound_track(CANTINA_SND_THEME);
     } else if (Xbox.getButtonPress(R2, 0)) {
-      play_sound_track(random(R2THEME_MUS_START, R2THEME_MUS_END));
+      play_sound_track(sndBanks->next(SND_BANK_R2THEME_MUS));
     } else {
-      play_sound_track(random(HAPPY_SND_START, HAPPY_SND_END));
+      play_sound_track(sndBanks->next(SND_BANK_HAPPY));
     }
   }
 
   // B Button and B combo Buttons
   if (Xbox.getButtonClick(B, 0)) {
     if (Xbox.getButtonPress(L1, 0)) {
-      play_sound_track(random(SAD_SND_START, SAD_SND_END));
+      play_sound_track(sndBanks->next(SND_BANK_SAD));
     } else if (Xbox.getButtonPress(L2, 0)) {
-      play_sound_track(random(RANDOM_MUS_START, RANDOM_MUS_END));
+      play_sound_track(sndBanks->next(SND_BANK_RANDOM_MUS));
     } else if (Xbox.getButtonPress(R1, 0)) {
       play_sound_track(SW_CHORUS_THEME);
     } else if (Xbox.getButtonPress(R2, 0)) {
       play_sound_track(ANNOYED_SND);
     } else {
-      play_sound_track(random(PROC_SND_START, PROC_SND_END));
+      play_sound_track(sndBanks->next(SND_BANK_PROC));
     }
   }
 
   // get battery levels
   if (Xbox.getButtonClick(XBOX, 0)) {
-    Log.notice(F("Xbox Battery Level: %d"CR), Xbox.getBatteryLevel(0));
+    diagSection = DIAG_BATTERY;
+    diagLine = 0;
   }
 
   // MOVE OUT THE WAY
@@ -382,11 +546,6 @@ void loop() {
     }
     play_sound_track(PROC_SND_START);
   }
-
-  drive();
-  is_disconnect();
-  automation_mode();
-  ts->loop();
 }
 
 void drive() {
@@ -395,44 +554,29 @@ void drive() {
   // Sabertooth runs at 8 bit signed. -127 to 127 for speed (full speed reverse and full speed forward)
   // Map the 360 stick values to our min/max current drive speed
   if (abs((long) Xbox.getAnalogHat(RightHatY, 0)) > RIGHT_HAT_Y_NEUTRAL) {
-    sticknum = (map(Xbox.getAnalogHat(RightHatY, 0), -32768, 32767, -drivespeed, drivespeed));
-    if (driveThrottle < sticknum) {
-      if (sticknum - driveThrottle < (RAMPING + 1) ) {
-        driveThrottle += RAMPING;
-      } else {
-        driveThrottle = sticknum;
-      }
-    } else if (driveThrottle > sticknum) {
-      if (driveThrottle - sticknum < (RAMPING + 1) ) {
-        driveThrottle -= RAMPING;
-      } else {
-        driveThrottle = sticknum;
-      }
-    }
+    sticknum = stick_to_throttle(Xbox.getAnalogHat(RightHatY, 0), RIGHT_HAT_Y_NEUTRAL, drivespeed);
+    driveThrottle = ramp_throttle(driveThrottle, sticknum, RAMPING);
+    isDriveRamping = (driveThrottle != sticknum);
   } else {
     driveThrottle = 0;
+    isDriveRamping = false;
   }
 
-  if (abs((long) Xbox.getAnalogHat(RightHatX, 0)) > RIGHT_HAT_X_NEUTRAL) {
-    turnThrottle = map(Xbox.getAnalogHat(RightHatX, 0), -32768, 32767, -TURNSPEED, TURNSPEED);
-  } else {
-    turnThrottle = 0;
-  }
+  turnThrottle = stick_to_throttle(Xbox.getAnalogHat(RightHatX, 0), RIGHT_HAT_X_NEUTRAL, TURNSPEED);
 
   // DRIVE!
   // right stick (drive)
   if (isDriveEnabled) {
-    Sabertooth2xXX.turn(turnThrottle);
-    Sabertooth2xXX.drive(driveThrottle);
+    arbiter->post(MOTOR_TURN, MOTOR_SRC_STICK, turnThrottle, MOTOR_STICK_TTL_MS);
+    arbiter->post(MOTOR_DRIVE, MOTOR_SRC_STICK, driveThrottle, MOTOR_STICK_TTL_MS);
+  } else {
+    arbiter->release(MOTOR_TURN, MOTOR_SRC_STICK);
+    arbiter->release(MOTOR_DRIVE, MOTOR_SRC_STICK);
   }
 
   // DOME DRIVE!
-  if (abs((long) Xbox.getAnalogHat(LeftHatX, 0)) > LEFT_HAT_X_NEUTRAL) {
-    domeThrottle = (map(Xbox.getAnalogHat(LeftHatX, 0), -32768, 32767, -DOMESPEED, DOMESPEED));
-  } else {
-    domeThrottle = 0;
-  }
-  Syren10.motor(1, domeThrottle);
+  domeThrottle = stick_to_throttle(Xbox.getAnalogHat(LeftHatX, 0), LEFT_HAT_X_NEUTRAL, DOMESPEED);
+  dome->setManualThrottle(domeThrottle);
 }
 
 /**
@@ -463,16 +607,23 @@ void automation_mode() {
       automateMillis = millis();
       automateAction = random(1, 5);
       if (automateAction > 1) {
-        play_sound_track(random(AUTO_SND_START, AUTO_SND_END));
+        play_sound_track(sndBanks->next(SND_BANK_AUTO));
       }
       if (automateAction < 4) {
-        Syren10.motor(1, turnDirection);
-        delay(750);
-        Syren10.motor(1, 0);
-        if (turnDirection > 0) {
-          turnDirection = -45;
+        if (dome->hasPosition() && dome->getTargetAngle() != 0) {
+          // look back to the front before the next look around
+          dome->faceForward(MOTOR_SRC_AUTOMATION);
         } else {
-          turnDirection = 45;
+          if (dome->hasPosition()) {
+            dome->moveTo(turnDirection, MOTOR_SRC_AUTOMATION);
+          } else {
+            dome->spin(turnDirection, AUTO_TURN_MILLIS, MOTOR_SRC_AUTOMATION);
+          }
+          if (turnDirection > 0) {
+            turnDirection = -45;
+          } else {
+            turnDirection = 45;
+          }
         }
       }
       // sets the mix, max seconds between automation actions - sounds and dome movement
@@ -481,57 +632,47 @@ void automation_mode() {
   }
 }
 
+/**
+   Runs the audio boot stage, each WAV Trigger query is answered over a few loops.  If the WAV
+   Trigger doesn't answer the droid boots without the info.
+*/
+void boot_audio() {
+  if (boot->isDone(BOOT_AUDIO)) {
+    return;
+  }
+
+  uint8_t rsp = wTrig.update();
+  if (rsp == RSP_VERSION_STRING) {
+    wTrig.request(CMD_GET_SYS_INFO);
+    audioQueryMillis = millis();
+  } else if (rsp == RSP_SYS_INFO) {
+    print_wav_info();
+    set_volume(vol);
+    boot->done(BOOT_AUDIO);
+  } else if (millis() - audioQueryMillis > BOOT_AUDIO_TIMEOUT_MS) {
+    set_volume(vol);
+    boot->done(BOOT_AUDIO, false);
+  }
+}
+
 void print_wav_info() {
-  wTrig.getVersion();
   uint8_t* sysVersion;
   sysVersion = wTrig.returnSysVersion();
   Log.notice(F("Sys Version: %x"CR), sysVersion);
-  wTrig.getSysInfo();
   Log.notice(F(" -- Number of tracks: %d"CR), wTrig.returnSysinfoTracks());
   Log.notice(F(" -- Number of voices: %d"CR), wTrig.returnSysinfoVoices());
 }
 
 void play_sound_track(int track) {
-  wTrig.getStatus();
-  uint16_t* tracks = wTrig.returnTracksPlaying();
-
-  if (track > BG_MUS_START) {
-    isBgMusicPlaying = !isBgMusicPlaying;
-  }
-
-  for (byte i = 0; i < 14; i++) {
-    Log.trace(F("Background tracks [%d] : %d"CR), i, tracks[i]);
-    if (tracks[i] <= BG_MUS_START) {
-      wTrig.trackStop(tracks[i]);
-    } else if (tracks[i] > BG_MUS_START && track > BG_MUS_START && isBgMusicPlaying == false) {
-      wTrig.trackStop(tracks[i]);
-    }
-  }
-
-  Log.notice(F("Playing track: %d"CR), track);
-  if (track > BG_MUS_START && isBgMusicPlaying == false) {
-    return;
-  }
-  wTrig.trackPlayPoly(track);
+  player->play(track);
 }
 
 void set_volume(int vol) {
-  Log.notice(F("Setting volume: %d"CR), vol);
-  wTrig.masterGain(vol);
+  player->setVolume(vol);
 }
 
 void send_periscope_command(byte cmd) {
-  // 0: DO NOTHING - ALLOW I2C TO TAKE CONTROL
-  // 1: DOWN POSITION - ALL OFF
-  // 2: FAST UP - RANDOM LIGHTS
-  // 3: SEARCHLIGHT - CCW
-  // 4: RANDOM - FAST
-  // 5: RANDOM - SLOW
-  // 6: DAGOBAH - WHITE LIGHTS - FACE FORWARD
-  // 7: SEARCHLIGHT CW
-  byte dev_address = 0x20;
-  Wire.beginTransmission(dev_address); // transmit to device #20
-  Wire.write(cmd); // sends one byte 0011
-  Wire.endTransmission(); // stop transmitting
-  Log.notice(F("Sent command: %d to device ID: %d"CR), cmd, dev_address);
+  // queued, goes out with any other dome commands when the loop flushes the I2C devices
+  // see DomeDevices.h for the command list
+  domeDevs->queue(DOME_DEV_PERISCOPE, cmd);
 }
@@ -0,0 +1,130 @@
+#include "SoundBanks.h"
+
+typedef struct
+{
+  uint16_t start;
+  uint16_t end;
+  uint8_t weight;
+} SoundBank;
+
+#define BANK_FITS(start, end) \
+  static_assert((end) >= (start) && (end) - (start) + 1 <= SND_BANK_MAX_TRACKS, #start " bank doesn't fit a shuffle bag")
+
+static const SoundBank BANKS[SND_BANK_COUNT] PROGMEM = {
+  { GEN_SND_START, GEN_SND_END, 1 },
+  { CHAT_SND_START, CHAT_SND_END, 1 },
+  { HAPPY_SND_START, HAPPY_SND_END, 1 },
+  { SAD_SND_START, SAD_SND_END, 1 },
+  { HUM_SND_START, HUM_SND_END, 1 },
+  { LEIA_SND_START, LEIA_SND_END, 1 },
+  { SCREAM_SND_START, SCREAM_SND_END, 1 },
+  { PROC_SND_START, PROC_SND_END, 1 },
+  { PROC_SND_START + 1, PROC_SND_END, 1 },
+  { WHISTLE_SND_START, WHISTLE_SND_END, 1 },
+  { AUTO_SND_START, AUTO_SND_END, 1 },
+  { RANDOM_MUS_START, RANDOM_MUS_END, 1 },
+  { HOLIDAY_MUS_START, HOLIDAY_MUS_END, 1 },
+  { R2THEME_MUS_START, R2THEME_MUS_END, 1 }
+};
+
+BANK_FITS(GEN_SND_START, GEN_SND_END);
+BANK_FITS(CHAT_SND_START, CHAT_SND_END);
+BANK_FITS(HAPPY_SND_START, HAPPY_SND_END);
+BANK_FITS(SAD_SND_START, SAD_SND_END);
+BANK_FITS(HUM_SND_START, HUM_SND_END);
+BANK_FITS(LEIA_SND_START, LEIA_SND_END);
+BANK_FITS(SCREAM_SND_START, SCREAM_SND_END);
+BANK_FITS(PROC_SND_START, PROC_SND_END);
+BANK_FITS(WHISTLE_SND_START, WHISTLE_SND_END);
+BANK_FITS(AUTO_SND_START, AUTO_SND_END);
+BANK_FITS(RANDOM_MUS_START, RANDOM_MUS_END);
+BANK_FITS(HOLIDAY_MUS_START, HOLIDAY_MUS_END);
+BANK_FITS(R2THEME_MUS_START, R2THEME_MUS_END);
+
+// set bits in a nibble, lets the bag skip whole bytes when looking for the n-th unplayed track
+static const uint8_t NIBBLE_BITS[16] PROGMEM = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+static uint8_t bits_set(uint8_t b) {
+  return pgm_read_byte(&NIBBLE_BITS[b & 0x0F]) + pgm_read_byte(&NIBBLE_BITS[b >> 4]);
+}
+
+static uint8_t bank_size(SoundBankId bank) {
+  return pgm_read_word(&BANKS[bank].end) - pgm_read_word(&BANKS[bank].start) + 1;
+}
+
+SoundBanks::SoundBanks() {
+  for (uint8_t bank = 0; bank < SND_BANK_COUNT; bank++) {
+    bags[bank].last = 0xFF;
+    refill((SoundBankId) bank);
+  }
+}
+
+SoundBanks* SoundBanks::getInstance() {
+  static SoundBanks banks;
+  return &banks;
+}
+
+void SoundBanks::refill(SoundBankId bank) {
+  ShuffleBag* bag = &bags[bank];
+  uint8_t size = bank_size(bank);
+  memset(bag->played, 0, sizeof(bag->played));
+  // the tracks past the end of the bank count as played so they are never picked
+  for (uint8_t i = size; i < SND_BANK_MAX_TRACKS; i++) {
+    bag->played[i >> 3] |= _BV(i & 7);
+  }
+  bag->remaining = size;
+  // keep the track that was just played out of the new bag so it can't repeat across refills
+  if (size > 1 && bag->last < size) {
+    bag->played[bag->last >> 3] |= _BV(bag->last & 7);
+    bag->remaining--;
+  }
+}
+
+int SoundBanks::next(SoundBankId bank) {
+  ShuffleBag* bag = &bags[bank];
+  if (bag->remaining == 0) {
+    refill(bank);
+  }
+
+  // the n-th track still in the bag, skipping a byte at a time
+  uint8_t n = random(bag->remaining);
+  uint8_t i = 0;
+  uint8_t unplayed = 8 - bits_set(bag->played[0]);
+  while (n >= unplayed) {
+    n -= unplayed;
+    i++;
+    unplayed = 8 - bits_set(bag->played[i]);
+  }
+  uint8_t bit = 0;
+  for (;; bit++) {
+    if (!(bag->played[i] & _BV(bit))) {
+      if (n == 0) {
+        break;
+      }
+      n--;
+    }
+  }
+
+  uint8_t track = (i << 3) + bit;
+  bag->played[i] |= _BV(bit);
+  bag->remaining--;
+  bag->last = track;
+  return pgm_read_word(&BANKS[bank].start) + track;
+}
+
+int SoundBanks::nextWeighted(const SoundBankId* banks, uint8_t count) {
+  uint16_t total = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    total += pgm_read_byte(&BANKS[banks[i]].weight);
+  }
+
+  uint16_t pick = random(total);
+  for (uint8_t i = 0; i < count; i++) {
+    uint8_t weight = pgm_read_byte(&BANKS[banks[i]].weight);
+    if (pick < weight) {
+      return next(banks[i]);
+    }
+    pick -= weight;
+  }
+  return next(banks[count - 1]);
+}
@@ -0,0 +1,72 @@
+#ifndef SOUND_BANKS_H_
+#define SOUND_BANKS_H_
+
+#if (ARDUINO >= 100)
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <ArduinoLog.h>
+
+#include "Sounds.h"
+
+// a bank's shuffle bag is a bitset, one bit per track
+#define SND_BANK_MAX_TRACKS 64
+
+enum SoundBankId : uint8_t {
+  SND_BANK_GEN = 0,
+  SND_BANK_CHAT,
+  SND_BANK_HAPPY,
+  SND_BANK_SAD,
+  SND_BANK_HUM,
+  SND_BANK_LEIA,
+  SND_BANK_SCREAM,
+  SND_BANK_PROC,
+  // the processing sounds without the first one, which is used as the confirmation beep
+  SND_BANK_PROC_ALT,
+  SND_BANK_WHISTLE,
+  SND_BANK_AUTO,
+  SND_BANK_RANDOM_MUS,
+  SND_BANK_HOLIDAY_MUS,
+  SND_BANK_R2THEME_MUS,
+  SND_BANK_COUNT
+};
+
+/**
+   Picks tracks from the ranges in Sounds.h (both ends included) without repeats.  Every bank
+   keeps a shuffle bag of the tracks it hasn't played yet, once the bag is empty it is refilled
+   with everything but the track that was just played.
+*/
+class SoundBanks {
+
+    typedef struct
+    {
+      uint8_t played[SND_BANK_MAX_TRACKS / 8];
+      uint8_t remaining;
+      uint8_t last;
+    } ShuffleBag;
+
+  private:
+    ShuffleBag bags[SND_BANK_COUNT];
+
+    SoundBanks();
+    SoundBanks(SoundBanks const&); // copy disabled
+    void operator=(SoundBanks const&); // assigment disabled
+    void refill(SoundBankId bank);
+
+  public:
+    static SoundBanks* getInstance();
+
+    /**
+     * The next track from the bank's shuffle bag.
+     */
+    int next(SoundBankId bank);
+
+    /**
+     * Picks one of the given banks using the weights in the bank table, then the next track
+     * from its shuffle bag.
+     */
+    int nextWeighted(const SoundBankId* banks, uint8_t count);
+};
+#endif //SOUND_BANKS_H_
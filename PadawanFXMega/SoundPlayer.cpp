@@ -0,0 +1,41 @@
+#include "SoundPlayer.h"
+
+SoundPlayer::SoundPlayer() {}
+
+SoundPlayer* SoundPlayer::getInstance() {
+  static SoundPlayer player;
+  return &player;
+}
+
+void SoundPlayer::setup(WavTrigger2* wTrig) {
+  this->wTrig = wTrig;
+}
+
+void SoundPlayer::play(int track) {
+  wTrig->getStatus();
+  uint16_t* tracks = wTrig->returnTracksPlaying();
+
+  if (track > BG_MUS_START) {
+    isBgMusicPlaying = !isBgMusicPlaying;
+  }
+
+  for (byte i = 0; i < 14; i++) {
+    Log.trace(F("Background tracks [%d] : %d"CR), i, tracks[i]);
+    if (tracks[i] <= BG_MUS_START) {
+      wTrig->trackStop(tracks[i]);
+    } else if (tracks[i] > BG_MUS_START && track > BG_MUS_START && isBgMusicPlaying == false) {
+      wTrig->trackStop(tracks[i]);
+    }
+  }
+
+  Log.notice(F("Playing track: %d"CR), track);
+  if (track > BG_MUS_START && isBgMusicPlaying == false) {
+    return;
+  }
+  wTrig->trackPlayPoly(track);
+}
+
+void SoundPlayer::setVolume(int vol) {
+  Log.notice(F("Setting volume: %d"CR), vol);
+  wTrig->masterGain(vol);
+}
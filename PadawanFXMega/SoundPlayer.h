@@ -0,0 +1,40 @@
+#ifndef SOUND_PLAYER_H_
+#define SOUND_PLAYER_H_
+
+#if (ARDUINO >= 100)
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <ArduinoLog.h>
+
+#include "Sounds.h"
+#include "libs/WavTrigger2/WavTrigger2.h"
+
+/**
+   Plays tracks on the WAV Trigger.  Sounds cut off whatever sound is playing, tracks above
+   BG_MUS_START are background music and toggle, playing one stops any music that is on.
+*/
+class SoundPlayer {
+
+  private:
+    WavTrigger2* wTrig = NULL;
+    boolean isBgMusicPlaying = false;
+
+    SoundPlayer();
+    SoundPlayer(SoundPlayer const&); // copy disabled
+    void operator=(SoundPlayer const&); // assigment disabled
+
+  public:
+    static SoundPlayer* getInstance();
+
+    void setup(WavTrigger2* wTrig);
+
+    /**
+     * Asks the WAV Trigger what is playing (a blocking status query) before starting the track.
+     */
+    void play(int track);
+    void setVolume(int vol);
+};
+#endif //SOUND_PLAYER_H_
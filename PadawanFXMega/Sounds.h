@@ -10,6 +10,10 @@
 
 #define CONTROLLER_CONNECTED 1
 
+// Sound ranges include both the START and END track, SoundBanks.cpp builds a shuffle bag from each.
+// A range must not run into the next range or a sound that has its own button, only AUTO covers
+// other ranges on purpose.
+
 #define GEN_SND_START 1
 #define GEN_SND_END 25
 
@@ -38,7 +42,8 @@
 #define WHISTLE_SND_END 104
 
 #define AUTO_SND_START 1
-#define AUTO_SND_END 50
+// 50 is OVERHERE_SND, played by its own button
+#define AUTO_SND_END 49
 
 #define SW_SND_THEME 190
 #define EMPIRE_SND_THEME 192
@@ -53,7 +58,8 @@
 #define HOLIDAY_MUS_END 352
 
 #define R2THEME_MUS_START 176
-#define R2THEME_MUS_END 179
+// 179 starts the random music
+#define R2THEME_MUS_END 178
 
 #define DOODOO_SND 49
 #define OVERHERE_SND 50
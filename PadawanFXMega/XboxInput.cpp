@@ -0,0 +1,112 @@
+#include "XboxInput.h"
+
+static const ButtonEnum DIGITAL_BUTTONS[] = {
+  UP, RIGHT, DOWN, LEFT, BACK, START, L3, R3, L1, R1, XBOX, A, B, X, Y
+};
+
+static const AnalogHatEnum HATS[] = {
+  LeftHatX, LeftHatY, RightHatX, RightHatY
+};
+
+XboxInput::XboxInput() {}
+
+XboxInput* XboxInput::getInstance() {
+  static XboxInput input;
+  return &input;
+}
+
+void XboxInput::setup(USB* usb, XBOXRECV* xbox) {
+  this->usb = usb;
+  this->xbox = xbox;
+  reset();
+}
+
+void XboxInput::takeSnapshot(Snapshot* snapshot) {
+  snapshot->buttons = 0;
+  for (uint8_t i = 0; i < sizeof(DIGITAL_BUTTONS) / sizeof(DIGITAL_BUTTONS[0]); i++) {
+    if (xbox->getButtonPress(DIGITAL_BUTTONS[i], 0)) {
+      snapshot->buttons |= (1UL << i);
+    }
+  }
+  // the triggers are analog, getButtonPress returns their 0-255 value
+  snapshot->triggers[0] = xbox->getButtonPress(L2, 0);
+  snapshot->triggers[1] = xbox->getButtonPress(R2, 0);
+  for (uint8_t i = 0; i < 4; i++) {
+    snapshot->hats[i] = xbox->getAnalogHat(HATS[i], 0);
+  }
+}
+
+void XboxInput::recordChange(unsigned long now) {
+  if (hasLastChange) {
+    unsigned long interval = now - lastChangeMicros;
+    if (intervals == 0) {
+      minInterval = interval;
+      maxInterval = interval;
+      meanInterval = interval;
+    } else {
+      minInterval = (interval < minInterval) ? interval : minInterval;
+      maxInterval = (interval > maxInterval) ? interval : maxInterval;
+      // exponential moving averages with a 1/8 weight, cheap enough to run per change
+      long deviation = (long) interval - (long) meanInterval;
+      meanInterval = (long) meanInterval + deviation / 8;
+      meanJitter = (long) meanJitter + ((long) abs(deviation) - (long) meanJitter) / 8;
+    }
+    intervals++;
+  }
+  hasLastChange = true;
+  lastChangeMicros = now;
+  changes++;
+}
+
+boolean XboxInput::poll() {
+  usb->Task();
+  isFreshReport = false;
+
+  if (!xbox->XboxReceiverConnected || !xbox->Xbox360Connected[0]) {
+    return false;
+  }
+
+  Snapshot curr;
+  takeSnapshot(&curr);
+  if (memcmp(&curr, &last, sizeof(Snapshot)) != 0) {
+    last = curr;
+    isFreshReport = true;
+    recordChange(micros());
+  } else {
+    staleLoops++;
+  }
+  return isFreshReport;
+}
+
+boolean XboxInput::isFresh() {
+  return isFreshReport;
+}
+
+boolean XboxInput::isRefreshDue() {
+  return millis() - lastRefreshMillis >= INPUT_REFRESH_MILLIS;
+}
+
+void XboxInput::markRefreshed() {
+  lastRefreshMillis = millis();
+}
+
+void XboxInput::reset() {
+  // no button mask sets all 32 bits, the first report after a reconnect always reads as fresh
+  memset(&last, 0xFF, sizeof(Snapshot));
+  // the time spent disconnected is not a change interval
+  hasLastChange = false;
+}
+
+boolean XboxInput::report(uint8_t line) {
+  switch (line) {
+    case 0:
+      Log.notice(F("Xbox input: %l state changes, %l unchanged loops"CR), changes, staleLoops);
+      return true;
+    case 1:
+      Log.notice(F(" -- state change interval min %l us, max %l us, mean %l us, jitter %l us"CR),
+                 minInterval, maxInterval, meanInterval, meanJitter);
+      return true;
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,96 @@
+#ifndef XBOX_INPUT_H_
+#define XBOX_INPUT_H_
+
+#if (ARDUINO >= 100)
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+
+#include <ArduinoLog.h>
+#include <XBOXRECV.h>
+
+// Longest time the motor commands may go without being refreshed while the controller state is
+// unchanged, must stay well below the 900ms motor controller timeout.
+#define INPUT_REFRESH_MILLIS 100
+
+/**
+   Wraps the USB host and the Xbox receiver so the sketch only re-processes the controller when a
+   new report has actually changed its state.  The MAX3421E only raises INT for bus events, HID
+   reports are fetched by polling inside Usb.Task(), so a change is detected by comparing a
+   snapshot of the controller state after every task run.
+
+   XBOXRECV doesn't expose when a report arrives, a report identical to the last one (steady
+   sticks, a held button) can't be told apart from no report at all.  The timing statistics are
+   therefore intervals between state changes, not between reports.
+*/
+class XboxInput {
+
+    typedef struct
+    {
+      uint32_t buttons = 0;
+      uint8_t triggers[2] = {0, 0};
+      int16_t hats[4] = {0, 0, 0, 0};
+    } Snapshot;
+
+  private:
+    USB* usb = NULL;
+    XBOXRECV* xbox = NULL;
+    Snapshot last;
+    boolean isFreshReport = false;
+    unsigned long lastRefreshMillis = 0;
+
+    // state change statistics, intervals in micros
+    boolean hasLastChange = false;
+    unsigned long lastChangeMicros = 0;
+    unsigned long changes = 0;
+    unsigned long intervals = 0;
+    unsigned long staleLoops = 0;
+    unsigned long minInterval = 0;
+    unsigned long maxInterval = 0;
+    unsigned long meanInterval = 0;
+    unsigned long meanJitter = 0;
+
+    XboxInput();
+    XboxInput(XboxInput const&); // copy disabled
+    void operator=(XboxInput const&); // assigment disabled
+    void takeSnapshot(Snapshot* snapshot);
+    void recordChange(unsigned long now);
+
+  public:
+    static XboxInput* getInstance();
+
+    /**
+     * Sets the USB host and receiver to poll, must be called once before poll().
+     */
+    void setup(USB* usb, XBOXRECV* xbox);
+
+    /**
+     * Runs the USB task and checks the controller state, returns true when it changed.
+     */
+    boolean poll();
+
+    /**
+     * True when the last poll() found the controller state changed.
+     */
+    boolean isFresh();
+
+    /**
+     * True when nothing has refreshed the motor commands for INPUT_REFRESH_MILLIS, the caller is
+     * expected to refresh them and call markRefreshed().
+     */
+    boolean isRefreshDue();
+    void markRefreshed();
+
+    /**
+     * Forgets the last controller state, the next report is treated as fresh.
+     */
+    void reset();
+
+    /**
+     * Logs one line of the state change count and the change interval and jitter, returns false
+     * once line is past the last one.
+     */
+    boolean report(uint8_t line);
+};
+#endif //XBOX_INPUT_H_
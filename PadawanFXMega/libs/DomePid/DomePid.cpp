@@ -0,0 +1,164 @@
+/**
+  DomePid.cpp - A fixed point PID controller, the dome position control built on it and a dome
+  drive plant model.
+
+  BSD license, all text above must be included in any redistribution
+**/
+#include "DomePid.h"
+
+DomePid::DomePid(int16_t kp, int16_t ki, int16_t kd, int16_t outMax)
+  : kp(kp), ki(ki), kd(kd), outMax(outMax) {}
+
+void DomePid::reset() {
+  integral = 0;
+  lastError = 0;
+  hasLastError = false;
+}
+
+int16_t DomePid::update(int32_t error) {
+  int32_t derivative = hasLastError ? error - lastError : 0;
+  lastError = error;
+  hasLastError = true;
+
+  int32_t out = ((int32_t) kp * error + (int32_t) ki * integral + (int32_t) kd * derivative) >> PID_Q;
+
+  // only integrate while the output is not saturated so the integral can't wind up
+  if (out > outMax) {
+    out = outMax;
+  } else if (out < -outMax) {
+    out = -outMax;
+  } else if (ki != 0) {
+    integral += error;
+    int32_t integralMax = ((int32_t) outMax << PID_Q) / ki;
+    if (integral > integralMax) {
+      integral = integralMax;
+    } else if (integral < -integralMax) {
+      integral = -integralMax;
+    }
+  }
+  return (int16_t) out;
+}
+
+DomeAxis::DomeAxis(int32_t ticksPerRev, int16_t kp, int16_t ki, int16_t kd, int16_t maxSpeed, int16_t minSpeed,
+                   int16_t toleranceTicks, uint8_t settlePeriods)
+  : pid(kp, ki, kd, maxSpeed), ticksPerRev(ticksPerRev), minSpeed(minSpeed), toleranceTicks(toleranceTicks),
+    settlePeriods(settlePeriods) {}
+
+int32_t DomeAxis::index(int32_t homeTicks) {
+  int32_t drift = 0;
+  if (isIndexed) {
+    drift = homeTicks - homeOffset;
+    // the same home seen a turn later or earlier is no drift
+    drift %= ticksPerRev;
+    if (drift > ticksPerRev / 2) {
+      drift -= ticksPerRev;
+    } else if (drift <= -ticksPerRev / 2) {
+      drift += ticksPerRev;
+    }
+  }
+  homeOffset = homeTicks;
+  isIndexed = true;
+  return drift;
+}
+
+bool DomeAxis::hasIndex() {
+  return isIndexed;
+}
+
+int32_t DomeAxis::position(int32_t ticks) {
+  int32_t position = (ticks - homeOffset) % ticksPerRev;
+  return (position < 0) ? position + ticksPerRev : position;
+}
+
+int32_t DomeAxis::shortestError(int32_t ticks) {
+  int32_t error = (targetTicks - position(ticks)) % ticksPerRev;
+  if (error > ticksPerRev / 2) {
+    error -= ticksPerRev;
+  } else if (error <= -ticksPerRev / 2) {
+    error += ticksPerRev;
+  }
+  return error;
+}
+
+void DomeAxis::setTarget(int32_t targetTicks) {
+  this->targetTicks = targetTicks;
+  pid.reset();
+  hasLastError = false;
+  settledCount = 0;
+}
+
+int32_t DomeAxis::target() {
+  return targetTicks;
+}
+
+int16_t DomeAxis::update(int32_t ticks) {
+  int32_t error = shortestError(ticks);
+  // the change in error is the speed in ticks per period
+  int32_t moved = hasLastError ? error - lastError : 0;
+  lastError = error;
+  hasLastError = true;
+
+  int16_t out = pid.update(error);
+  if (error <= toleranceTicks && error >= -toleranceTicks) {
+    // inside the tolerance the PID only brakes and holds, it isn't pushed through the dead band
+    if (moved == 0) {
+      if (settledCount < settlePeriods) {
+        settledCount++;
+      }
+    } else {
+      settledCount = 0;
+    }
+    return out;
+  }
+
+  settledCount = 0;
+  // the dome won't move at all below the minimum, make sure the last few ticks still get closed
+  if (out > 0 && out < minSpeed) {
+    out = minSpeed;
+  } else if (out < 0 && out > -minSpeed) {
+    out = -minSpeed;
+  }
+  return out;
+}
+
+bool DomeAxis::hasArrived() {
+  return settledCount >= settlePeriods;
+}
+
+// floor division, the home index sits at every multiple of a revolution including negative ones
+static int32_t revolution(int32_t ticks, int32_t ticksPerRev) {
+  return (ticks >= 0) ? ticks / ticksPerRev : -((-ticks + ticksPerRev - 1) / ticksPerRev);
+}
+
+DomePlant::DomePlant(int32_t ticksPerRev, int32_t ticksPerSecAtFull, uint16_t tauMillis, int16_t stiction, int32_t startTicks)
+  : ticksPerRev(ticksPerRev), ticksPerSecAtFull(ticksPerSecAtFull), tauMillis(tauMillis), stiction(stiction),
+    milliTicks((int64_t) startTicks * 1000) {}
+
+bool DomePlant::step(int16_t command, uint16_t dtMillis) {
+  int32_t target = 0;
+  if (command > stiction || command < -stiction) {
+    target = (int32_t) command * ticksPerSecAtFull / 127;
+  }
+  if (dtMillis >= tauMillis) {
+    ticksPerSec = target;
+  } else {
+    // rounded, and snapped to the target once the step rounds to nothing, a truncated step
+    // leaves the speed stuck a few ticks/s short of the target and the model creeps forever
+    int32_t delta = (target - ticksPerSec) * dtMillis;
+    int32_t step = (delta + ((delta >= 0) ? tauMillis / 2 : -(tauMillis / 2))) / tauMillis;
+    ticksPerSec = (step == 0) ? target : ticksPerSec + step;
+  }
+
+  int32_t revBefore = revolution(position(), ticksPerRev);
+  // ticks/s * ms == 1/1000 ticks
+  milliTicks += (int64_t) ticksPerSec * dtMillis;
+  return revBefore != revolution(position(), ticksPerRev);
+}
+
+int32_t DomePlant::position() {
+  return (int32_t) (milliTicks / 1000);
+}
+
+int32_t DomePlant::speed() {
+  return ticksPerSec;
+}
@@ -0,0 +1,140 @@
+/**
+  DomePid.h - A fixed point PID controller, the dome position control built on it and a dome
+  drive plant model.
+
+  None of the classes depend on the Arduino core, so the controller can be tuned against the
+  model in a host build before it is run on the droid, see test/.
+
+  BSD license, all text above must be included in any redistribution
+**/
+#ifndef DomePid_h
+#define DomePid_h
+
+#include <stdint.h>
+
+// gains are fixed point with 8 fractional bits, 256 == 1.0
+#define PID_Q 8
+
+class DomePid {
+
+  private:
+    int16_t kp;
+    int16_t ki;
+    int16_t kd;
+    int16_t outMax;
+    int32_t integral = 0;
+    int32_t lastError = 0;
+    bool hasLastError = false;
+
+  public:
+    /**
+     * Gains are Q8 fixed point, outMax limits the output to +/- outMax.
+     */
+    DomePid(int16_t kp, int16_t ki, int16_t kd, int16_t outMax);
+
+    /**
+     * Clears the integral and derivative history, call when a new target is set.
+     */
+    void reset();
+
+    /**
+     * Runs one step of the controller, must be called at a fixed rate.  The gains are tuned for
+     * that rate so the time step does not show up in the math.
+     */
+    int16_t update(int32_t error);
+};
+
+/**
+  The closed loop part of the dome drive, without the hardware: the home index, the shortest way
+  around to a target, the PID with the dead band handling and the arrival check.  DomeController
+  feeds it encoder ticks and sends its commands to the Syren, the host test feeds it DomePlant.
+**/
+class DomeAxis {
+
+  private:
+    DomePid pid;
+    int32_t ticksPerRev;
+    int16_t minSpeed;
+    int16_t toleranceTicks;
+    uint8_t settlePeriods;
+    int32_t homeOffset = 0;
+    bool isIndexed = false;
+    int32_t targetTicks = 0;
+    int32_t lastError = 0;
+    bool hasLastError = false;
+    uint8_t settledCount = 0;
+
+  public:
+    /**
+     * Gains are Q8 for DomePid, commands between 0 and minSpeed are raised to minSpeed outside
+     * the tolerance so the dome doesn't stall short of the target.  A move has arrived once the
+     * error stayed within toleranceTicks without moving for settlePeriods updates.
+     */
+    DomeAxis(int32_t ticksPerRev, int16_t kp, int16_t ki, int16_t kd, int16_t maxSpeed, int16_t minSpeed,
+             int16_t toleranceTicks, uint8_t settlePeriods);
+
+    /**
+     * Sets the encoder count the home sensor was seen at.  Returns how far, in ticks, the
+     * previous index was off (the encoder drift), 0 the first time.
+     */
+    int32_t index(int32_t homeTicks);
+    bool hasIndex();
+
+    /**
+     * Encoder ticks turned into 0 to ticksPerRev - 1 past home.
+     */
+    int32_t position(int32_t ticks);
+
+    /**
+     * Ticks to go from ticks to target the short way around, positive is in the direction the
+     * encoder counts up.
+     */
+    int32_t shortestError(int32_t ticks);
+
+    /**
+     * Starts a move to targetTicks past home.
+     */
+    void setTarget(int32_t targetTicks);
+    int32_t target();
+
+    /**
+     * Runs one PID period with the current encoder count and returns the motor command.  Keeps
+     * holding the target until hasArrived().
+     */
+    int16_t update(int32_t ticks);
+    bool hasArrived();
+};
+
+/**
+  First order model of the Syren and dome motor: the speed follows the command with a time
+  constant and a stiction dead zone, the position integrates the speed.  Stands in for the
+  encoder while tuning.
+**/
+class DomePlant {
+
+  private:
+    int32_t ticksPerRev;
+    int32_t ticksPerSecAtFull;
+    uint16_t tauMillis;
+    int16_t stiction;
+    // position in 1/1000 ticks so slow speeds still move the model
+    int64_t milliTicks;
+    int32_t ticksPerSec = 0;
+
+  public:
+    /**
+     * ticksPerSecAtFull is the speed at a command of 127, commands below stiction do not move
+     * the dome, startTicks is where the dome sits at power on.
+     */
+    DomePlant(int32_t ticksPerRev, int32_t ticksPerSecAtFull, uint16_t tauMillis, int16_t stiction, int32_t startTicks);
+
+    /**
+     * Advances the model by dtMillis with the motor at command (-127 to 127).  Returns true if
+     * the home position (any multiple of a revolution) was passed.
+     */
+    bool step(int16_t command, uint16_t dtMillis);
+    int32_t position();
+    int32_t speed();
+};
+
+#endif // DomePid_h
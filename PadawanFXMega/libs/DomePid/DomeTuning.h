@@ -0,0 +1,33 @@
+/**
+  DomeTuning.h - The dome drive settings the PID gains were tuned for.
+
+  Shared by DomeController and the host test in test/, which checks the gains against DomePlant
+  with these values.  Retune and run the test when changing any of them.
+
+  BSD license, all text above must be included in any redistribution
+**/
+#ifndef DomeTuning_h
+#define DomeTuning_h
+
+// encoder edges for one full turn of the dome
+#define DOME_TICKS_PER_REV 1440
+
+// PID runs at a fixed rate, gains are Q8 (256 == 1.0) and tuned for this rate
+#define DOME_PID_INTERVAL_MS 20
+#define DOME_KP 640
+#define DOME_KI 0
+#define DOME_KD 3000
+#define DOME_MAX_SPEED 127
+// smallest command that still turns the dome
+#define DOME_MIN_SPEED 18
+// a move is done once the dome stopped within the tolerance for DOME_SETTLE_PERIODS PID periods
+#define DOME_TOLERANCE_TICKS 4
+#define DOME_SETTLE_PERIODS 5
+
+// the DomePlant the gains were tuned against: top speed at a command of 127, time constant and
+// the command below which the dome doesn't move
+#define DOME_MODEL_TICKS_PER_SEC 720
+#define DOME_MODEL_TAU_MS 150
+#define DOME_MODEL_STICTION (DOME_MIN_SPEED - 6)
+
+#endif // DomeTuning_h
@@ -0,0 +1,146 @@
+/**
+  DomePidTest.cpp - Runs DomeAxis with the tuning in DomeTuning.h against DomePlant on the host.
+
+  make -C libs/DomePid/test
+
+  BSD license, all text above must be included in any redistribution
+**/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "DomePid.h"
+#include "DomeTuning.h"
+
+// longest a move may take to come to rest on its target, half a turn included
+#define SETTLE_LIMIT_MS 2000
+// how long the dome is left alone after arriving before the final error is checked
+#define COAST_MS 1000
+#define HOMING_SPEED 25
+#define HOMING_TIMEOUT_MS 15000
+
+static int failures = 0;
+
+static void check(bool isOk, const char* what, long a, long b) {
+  if (!isOk) {
+    printf("FAIL %s (%ld, %ld)\n", what, a, b);
+    failures++;
+  }
+}
+
+static DomePlant makePlant(int32_t startTicks) {
+  return DomePlant(DOME_TICKS_PER_REV, DOME_MODEL_TICKS_PER_SEC, DOME_MODEL_TAU_MS, DOME_MODEL_STICTION, startTicks);
+}
+
+static DomeAxis makeAxis() {
+  return DomeAxis(DOME_TICKS_PER_REV, DOME_KP, DOME_KI, DOME_KD, DOME_MAX_SPEED, DOME_MIN_SPEED,
+                  DOME_TOLERANCE_TICKS, DOME_SETTLE_PERIODS);
+}
+
+// a motor left at 0 has to come to a stop instead of creeping
+static void testPlantStops() {
+  DomePlant plant = makePlant(0);
+  for (int i = 0; i < 1000 / DOME_PID_INTERVAL_MS; i++) {
+    plant.step(60, DOME_PID_INTERVAL_MS);
+  }
+  for (int i = 0; i < 1000 / DOME_PID_INTERVAL_MS; i++) {
+    plant.step(0, DOME_PID_INTERVAL_MS);
+  }
+  int32_t stopped = plant.position();
+  for (int i = 0; i < 10000 / DOME_PID_INTERVAL_MS; i++) {
+    plant.step(0, DOME_PID_INTERVAL_MS);
+  }
+  check(plant.speed() == 0, "plant speed at command 0", plant.speed(), 0);
+  check(plant.position() == stopped, "plant creeps at command 0", plant.position(), stopped);
+}
+
+// turns forward until the home edge like DomeController does and returns the ms it took
+static long home(DomePlant& plant, DomeAxis& axis) {
+  for (long ms = 0; ms < HOMING_TIMEOUT_MS; ms += DOME_PID_INTERVAL_MS) {
+    if (plant.step(HOMING_SPEED, DOME_PID_INTERVAL_MS) && plant.speed() > 0) {
+      axis.index(plant.position());
+      return ms;
+    }
+  }
+  return -1;
+}
+
+static void testHomingAndMoves() {
+  long worstSettleMs = 0;
+  long worstError = 0;
+  int moves = 0;
+
+  for (int32_t start = 0; start < DOME_TICKS_PER_REV; start += 173) {
+    for (int16_t degrees = -180; degrees <= 180; degrees += 45) {
+      DomePlant plant = makePlant(start);
+      DomeAxis axis = makeAxis();
+      long homingMs = home(plant, axis);
+      check(homingMs >= 0, "homing from", start, homingMs);
+      if (homingMs < 0) {
+        continue;
+      }
+
+      int32_t target = (((degrees % 360) + 360) % 360) * DOME_TICKS_PER_REV / 360;
+      axis.setTarget(target);
+      long settleMs = -1;
+      int16_t command = 0;
+      for (long ms = 0; ms <= SETTLE_LIMIT_MS; ms += DOME_PID_INTERVAL_MS) {
+        command = axis.update(plant.position());
+        if (axis.hasArrived()) {
+          settleMs = ms;
+          break;
+        }
+        plant.step(command, DOME_PID_INTERVAL_MS);
+      }
+      check(settleMs >= 0, "move did not settle, target", target, axis.shortestError(plant.position()));
+
+      for (long ms = 0; ms < COAST_MS; ms += DOME_PID_INTERVAL_MS) {
+        plant.step(0, DOME_PID_INTERVAL_MS);
+      }
+      long error = labs(axis.shortestError(plant.position()));
+      check(error <= DOME_TOLERANCE_TICKS, "final error, target", target, error);
+
+      worstSettleMs = (settleMs > worstSettleMs) ? settleMs : worstSettleMs;
+      worstError = (error > worstError) ? error : worstError;
+      moves++;
+    }
+  }
+  printf("%d moves, slowest settled in %ld ms, worst final error %ld ticks\n", moves, worstSettleMs, worstError);
+}
+
+// every pass over home corrects the drift, including passes a turn later
+static void testReindex() {
+  DomeAxis axis = makeAxis();
+  check(axis.index(100) == 0, "first index drift", 0, 0);
+  check(axis.position(100) == 0, "position at home", axis.position(100), 0);
+  int32_t drift = axis.index(100 + DOME_TICKS_PER_REV + 7);
+  check(drift == 7, "drift a turn later", drift, 7);
+  drift = axis.index(100 + 2 * DOME_TICKS_PER_REV - 3);
+  check(drift == -10, "drift two turns later", drift, -10);
+  check(axis.position(100 + 2 * DOME_TICKS_PER_REV - 3) == 0, "position after re-index",
+        axis.position(100 + 2 * DOME_TICKS_PER_REV - 3), 0);
+}
+
+static void testShortestError() {
+  DomeAxis axis = makeAxis();
+  axis.index(0);
+  axis.setTarget(10);
+  check(axis.shortestError(DOME_TICKS_PER_REV - 10) == 20, "shortest error across home",
+        axis.shortestError(DOME_TICKS_PER_REV - 10), 20);
+  axis.setTarget(DOME_TICKS_PER_REV - 10);
+  check(axis.shortestError(10) == -20, "shortest error back across home", axis.shortestError(10), -20);
+  check(axis.shortestError(-10 - DOME_TICKS_PER_REV) == 0, "shortest error a turn away",
+        axis.shortestError(-10 - DOME_TICKS_PER_REV), 0);
+}
+
+int main() {
+  testPlantStops();
+  testShortestError();
+  testReindex();
+  testHomingAndMoves();
+  if (failures != 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
@@ -50,16 +50,48 @@ void WavTrigger2::response(uint8_t responseCommand) {
     s->flush();
     //s->clear();
 
-    uint8_t txbuf[5];
+    WavTrigger2::request(responseCommand);
+    WavTrigger2::readResponse(2000);
+}
+
+// **************************************************************
+void WavTrigger2::request(uint8_t requestCommand) {
 
-    txbuf[0] = HEAD_1;
-    txbuf[1] = HEAD_2;
-    txbuf[2] = 0x05;
-    txbuf[3] = responseCommand;
-    txbuf[4] = EOM;
-    s->write(txbuf, 5);
+  uint8_t txbuf[5];
 
-    WavTrigger2::readResponse(2000);
+  txbuf[0] = HEAD_1;
+  txbuf[1] = HEAD_2;
+  txbuf[2] = 0x05;
+  txbuf[3] = requestCommand;
+  txbuf[4] = EOM;
+  s->write(txbuf, 5);
+  rxIndex = 0;
+}
+
+// **************************************************************
+uint8_t WavTrigger2::update(void) {
+
+  while (s->available()) {
+    uint8_t b = s->read();
+    // resync on the header, the length byte counts the whole packet
+    if ((rxIndex == 0 && b != HEAD_1) || (rxIndex == 1 && b != HEAD_2)) {
+      rxIndex = 0;
+      continue;
+    }
+    if (rxIndex == 2 && (b < 5 || b > sizeof(packet))) {
+      rxIndex = 0;
+      continue;
+    }
+    packet[rxIndex++] = b;
+    if (rxIndex > 2 && rxIndex == packet[2]) {
+      rxIndex = 0;
+      if (b == EOM) {
+        WavTrigger2::parseResponse();
+        return packet[3];
+      }
+    }
+  }
+  return 0;
 }
 
 // **************************************************************
@@ -76,18 +108,28 @@ void WavTrigger2::readResponse(unsigned long wait) {
   if (s->available() >= 5) {
 
     uint8_t i = 0;
-    while (s->available()) {
+    boolean isComplete = false;
+    while (i < sizeof(packet)) {
+      // MCU is faster than the serial line, wait a short while for the rest of the packet
+      // instead of a fixed delay per byte
+      unsigned long byteStop = millis() + BYTE_WAIT_MILLIS;
+      while (!s->available() && millis() < byteStop) {
+      }
+      if (!s->available()) {
+        break;
+      }
       packet[i] = s->read();
       if (packet[i] == EOM) {
+        isComplete = true;
         break;
       } else {
         i++;
       }
-      delay(20); // MCU was too fast so had to put in delay
     }
 
     // check packet
     if (
+      isComplete &&
       packet[0] == HEAD_1 &&
       packet[1] == HEAD_2 &&
       packet[i] == EOM
@@ -28,6 +28,8 @@
 // 10/03/16  Changed to use streams, allow for HW or Software serial.
 //           Also added status method to get playing tracks and reading
 //           information like the number of tracks, etc. - Manny
+//
+// 10/19/26  Added request/update for reading responses without blocking.
 
 #ifndef wavTrigger2_H_
 #define wavTrigger2_H_
@@ -60,6 +62,9 @@
 #define HEAD_2                  0xaa
 #define EOM                     0x55
 
+// max gap between two bytes of the same response packet
+#define BYTE_WAIT_MILLIS        5
+
 class WavTrigger2
 {
 public:
@@ -86,6 +91,11 @@ public:
   void getSysInfo(void);
   void getStatus(void);
 
+  // non-blocking queries, request() sends the query and update() returns the RSP_ code of the
+  // response once it has been received and parsed, 0 until then
+  void request(uint8_t requestCommand);
+  uint8_t update(void);
+
   uint8_t* returnSysVersion(void);
   uint8_t returnSysinfoVoices(void);
   uint16_t returnSysinfoTracks(void);
@@ -102,6 +112,7 @@ private:
   Stream* s;
 
   uint8_t packet[40];
+  uint8_t rxIndex = 0;
 
   uint8_t sysVersion[20];
   uint8_t sysinfoVoices;